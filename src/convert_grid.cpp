@@ -0,0 +1,126 @@
+#include "io/config.hpp"
+#include "io/grid_reader.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+using nast_hpx::io::binary_grid_header;
+using nast_hpx::io::grid_header;
+using nast_hpx::io::grid_reader;
+
+/// Converts a grid file into the binary grid format, optionally with
+/// run-length compressed planes.
+int main(int argc, char* argv[])
+{
+    bool run_length = false;
+    std::vector<const char*> paths;
+
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        if (std::strcmp(argv[arg], "--rle") == 0)
+            run_length = true;
+        else
+            paths.push_back(argv[arg]);
+    }
+
+    if (paths.size() != 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " [--rle] <input grid> <output grid>" << std::endl;
+        return 1;
+    }
+
+    grid_header header = grid_reader::read_header(paths[0]);
+
+    // read the whole domain as a single partition
+    nast_hpx::io::config cfg;
+    cfg.cells_x_per_partition = header.i_max + 2;
+    cfg.cells_y_per_partition = header.j_max + 2;
+    cfg.cells_z_per_partition = header.k_max + 2;
+
+    std::size_t const num_fluid_cells =
+        grid_reader::read_partition(paths[0], header, cfg, 0, 0, 0, false);
+
+    std::size_t const res_x = header.i_max + 2;
+    std::size_t const res_y = header.j_max + 2;
+    std::size_t const res_z = header.k_max + 2;
+
+    std::size_t const flag_res_x = res_x + 2;
+    std::size_t const flag_res_y = res_y + 2;
+
+    std::vector<std::vector<std::uint16_t> > planes(res_z);
+
+    for (std::size_t k = 0; k < res_z; ++k)
+    {
+        std::vector<std::uint16_t>& plane = planes[k];
+
+        for (std::size_t j = 0; j < res_y; ++j)
+        {
+            for (std::size_t i = 0; i < res_x; ++i)
+            {
+                std::uint16_t const flag = static_cast<std::uint16_t>(
+                    cfg.flag_grid[(k + 1) * flag_res_x * flag_res_y
+                                    + (j + 1) * flag_res_x + i + 1].to_ulong());
+
+                if (!run_length)
+                    plane.push_back(flag);
+                else if (!plane.empty() && plane.back() == flag
+                        && plane[plane.size() - 2] < std::numeric_limits<std::uint16_t>::max())
+                    ++plane[plane.size() - 2];
+                else
+                {
+                    plane.push_back(1);
+                    plane.push_back(flag);
+                }
+            }
+        }
+    }
+
+    binary_grid_header binary_header;
+    std::memcpy(binary_header.magic, nast_hpx::io::binary_grid_magic, sizeof(binary_header.magic));
+
+    binary_header.i_max = header.i_max;
+    binary_header.j_max = header.j_max;
+    binary_header.k_max = header.k_max;
+    binary_header.run_length = run_length ? 1 : 0;
+
+    binary_header.x_length = header.x_length;
+    binary_header.y_length = header.y_length;
+    binary_header.z_length = header.z_length;
+
+    std::vector<std::uint64_t> offsets(res_z + 1);
+    offsets[0] = sizeof(binary_grid_header) + offsets.size() * sizeof(std::uint64_t);
+
+    for (std::size_t k = 0; k < res_z; ++k)
+        offsets[k + 1] = offsets[k] + planes[k].size() * sizeof(std::uint16_t);
+
+    std::ofstream file(paths[1], std::ios::binary | std::ios::trunc);
+
+    if (!file)
+    {
+        std::cerr << "Could not open " << paths[1] << " for writing!" << std::endl;
+        return 1;
+    }
+
+    file.write(reinterpret_cast<char const*>(&binary_header), sizeof(binary_header));
+    file.write(reinterpret_cast<char const*>(offsets.data()), offsets.size() * sizeof(std::uint64_t));
+
+    for (auto const& plane : planes)
+        file.write(reinterpret_cast<char const*>(plane.data()), plane.size() * sizeof(std::uint16_t));
+
+    if (!file)
+    {
+        std::cerr << "Error: could not write " << paths[1] << "!" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Wrote " << paths[1] << ": " << res_x << "x" << res_y << "x" << res_z
+        << " cells, " << num_fluid_cells << " fluid, " << offsets.back() << " bytes" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,163 @@
+#include "io/snapshot.hpp"
+#include "io/vtk.hpp"
+#include "util/defines.hpp"
+
+#include <bitset>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using nast_hpx::io::snapshot;
+using nast_hpx::io::snapshot_header;
+using nast_hpx::io::vtk;
+
+/// Converts compressed snapshots into VTK RectilinearGrids. The snapshot of
+/// the root locality also gets the pvtr referencing the pieces of all
+/// localities of its output step.
+int main(int argc, char* argv[])
+{
+    int compression_level = 0;
+    std::vector<std::string> paths;
+
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        if (std::strcmp(argv[arg], "--level") == 0 && arg + 1 < argc)
+            compression_level = std::atoi(argv[++arg]);
+        else
+            paths.push_back(argv[arg]);
+    }
+
+    if (paths.empty() || compression_level < 0 || compression_level > 9)
+    {
+        std::cerr << "Usage: " << argv[0] << " [--level <zlib level>] <snapshot>..." << std::endl;
+        return 1;
+    }
+
+#ifndef NAST_HPX_WITH_ZLIB
+    compression_level = 0;
+#endif
+
+    std::string const suffix = ".nasz";
+
+    for (std::string const& path : paths)
+    {
+        if (path.size() <= suffix.size()
+            || path.compare(path.size() - suffix.size(), suffix.size(), suffix) != 0)
+        {
+            std::cerr << "Error: " << path << " is not a .nasz snapshot!" << std::endl;
+            return 1;
+        }
+
+        std::vector<std::uint16_t> flags;
+        std::vector<std::vector<double> > fields;
+        snapshot_header const header = snapshot::read(path, flags, fields);
+
+        if (header.num_fields != 4)
+        {
+            std::cerr << "Error: " << path << " does not hold p, u, v, w!" << std::endl;
+            return 1;
+        }
+
+        std::size_t const num_cells = flags.size();
+
+        std::vector<std::int32_t> obstacle(num_cells);
+        std::vector<double> velocity(3 * num_cells);
+
+        for (std::size_t id = 0; id < num_cells; ++id)
+        {
+            obstacle[id] = std::bitset<9>(flags[id]).test(is_fluid) ? 0 : 1;
+
+            for (std::size_t dim = 0; dim < 3; ++dim)
+                velocity[3 * id + dim] = fields[1 + dim][id];
+        }
+
+        std::vector<std::vector<char> > arrays;
+        arrays.push_back(vtk::encode(fields[0], compression_level));
+        arrays.push_back(vtk::encode(obstacle, compression_level));
+        arrays.push_back(vtk::encode(velocity, compression_level));
+
+        // the interior cell i of a partition is the global cell id * cells + i - 1
+        std::uint32_t const cells[3] = {header.cells_x, header.cells_y, header.cells_z};
+        std::uint32_t const ids[3] = {header.idx, header.idy, header.idz};
+        double const d[3] = {header.dx, header.dy, header.dz};
+
+        std::string extent;
+
+        for (std::size_t axis = 0; axis < 3; ++axis)
+        {
+            std::size_t const first = ids[axis] * cells[axis];
+
+            std::vector<double> coordinates;
+            for (std::size_t n = first; n <= first + cells[axis]; ++n)
+                coordinates.push_back(d[axis] * n);
+
+            arrays.push_back(vtk::encode(coordinates, compression_level));
+
+            extent += (axis == 0 ? "" : " ") + std::to_string(first) + " "
+                + std::to_string(first + cells[axis]);
+        }
+
+        std::string const prefix = path.substr(0, path.size() - suffix.size());
+        vtk::write_appended(prefix + ".vtr", "Float64", extent, arrays, compression_level);
+
+        std::cout << "Wrote " << prefix << ".vtr: step " << header.step << ", t = " << header.t
+            << (header.error_bound > 0 ? ", lossy" : ", lossless") << std::endl;
+
+        if (header.idx != 0 || header.idy != 0 || header.idz != 0)
+            continue;
+
+        // the root lists the pieces of all localities
+        std::string const root = "_locality_0";
+        if (prefix.size() < root.size()
+            || prefix.compare(prefix.size() - root.size(), root.size(), root) != 0)
+            continue;
+
+        std::string const step_prefix = prefix.substr(0, prefix.size() - root.size());
+        std::string const step_name = step_prefix.substr(step_prefix.find_last_of('/') + 1);
+
+        std::ofstream os(step_prefix + ".pvtr", std::ios::trunc);
+
+        os  << "<?xml version=\"1.0\"?>\n"
+            << "<VTKFile type=\"PRectilinearGrid\" version=\"0.1\" byte_order=\"LittleEndian\">\n"
+            << "<PRectilinearGrid WholeExtent=\"0 " << header.i_max << " 0 " << header.j_max
+                << " 0 " << header.k_max << "\" GhostLevel=\"0\">\n"
+            << "<PPointData>\n"
+            << "</PPointData>\n"
+            << "<PCellData>\n"
+            << "<PDataArray type=\"Float64\" Name=\"pressure\"/>\n"
+            << "<PDataArray type=\"Int32\" Name=\"obstacle\"/>\n"
+            << "<PDataArray type=\"Float64\" Name=\"velocity\" NumberOfComponents=\"3\"/>\n"
+            << "</PCellData>\n"
+            << "<PCoordinates>\n"
+            << "<PDataArray type=\"Float64\" Name=\"X_COORDINATES\" NumberOfComponents=\"1\"/>\n"
+            << "<PDataArray type=\"Float64\" Name=\"Y_COORDINATES\" NumberOfComponents=\"1\"/>\n"
+            << "<PDataArray type=\"Float64\" Name=\"Z_COORDINATES\" NumberOfComponents=\"1\"/>\n"
+            << "</PCoordinates>\n";
+
+        std::size_t const res_x = header.res_x;
+        std::size_t const res_y = header.res_y;
+
+        for (std::size_t loc = 0; loc < res_x * res_y * header.res_z; ++loc)
+        {
+            std::size_t const loc_ids[3] =
+                {(loc % (res_x * res_y)) % res_x, (loc % (res_x * res_y)) / res_x, loc / (res_x * res_y)};
+
+            os  << "<Piece Extent=\"";
+
+            for (std::size_t axis = 0; axis < 3; ++axis)
+                os  << (axis == 0 ? "" : " ") << loc_ids[axis] * cells[axis]
+                    << " " << (loc_ids[axis] + 1) * cells[axis];
+
+            os  << "\" Source=\"" << step_name << "_locality_" << loc << ".vtr\"/>\n";
+        }
+
+        os  << "</PRectilinearGrid>\n"
+            << "</VTKFile>\n";
+    }
+
+    return 0;
+}
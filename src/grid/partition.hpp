@@ -64,6 +64,18 @@ struct partition
         typename server::partition_server::do_timestep_action act;
         return hpx::async(act, get_id(), dt);
     }
+
+    hpx::future<bool> write_checkpoint(double dt, std::size_t stepper_step, double tau)
+    {
+        typename server::partition_server::write_checkpoint_action act;
+        return hpx::async(act, get_id(), dt, stepper_step, tau);
+    }
+
+    hpx::future<void> flush_output()
+    {
+        typename server::partition_server::flush_output_action act;
+        return hpx::async(act, get_id());
+    }
 };
 
 }//namespace grid
@@ -4,7 +4,11 @@
 #include "partition_data.hpp"
 #include "unpack_buffer.hpp"
 
+#include "util/halo_stats.hpp"
 #include "util/hpx_wrap.hpp"
+#include "util/phase_timer.hpp"
+
+#include <chrono>
 
 namespace nast_hpx { namespace grid {
 
@@ -42,11 +46,26 @@ namespace nast_hpx { namespace grid {
         {
         }
 
-        void operator()(partition_data<value_type>& p, std::size_t step)
+        void operator()(partition_data<value_type>& p, std::size_t step, std::size_t var)
         {
             HPX_ASSERT(valid_);
 
-            buffer_type buffer = buffer_.receive(step).get();
+            util::trace::tags const tags = util::trace::tags::halo(step, var, dir);
+
+            buffer_type buffer;
+
+            {
+                util::phase_timer::scope timer(util::phase_timer::halo_wait, tags);
+                auto const start = std::chrono::steady_clock::now();
+
+                buffer = buffer_.receive(step).get();
+
+                util::halo_stats::received(dir, var,
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - start).count());
+            }
+
+            util::trace::scope trace("unpack", tags);
 
             unpack_buffer<dir>::call(p, buffer);
         }
@@ -4,7 +4,9 @@
 #include "partition_data.hpp"
 #include "pack_buffer.hpp"
 
+#include "util/halo_stats.hpp"
 #include "util/hpx_wrap.hpp"
+#include "util/phase_timer.hpp"
 
 namespace nast_hpx { namespace grid {
 
@@ -39,10 +41,15 @@ namespace nast_hpx { namespace grid {
         {
             HPX_ASSERT(dest_);
 
+            util::phase_timer::scope timer(util::phase_timer::halo_send,
+                util::trace::tags::halo(step, var, dir));
+
             buffer_type buffer;
 
             pack_buffer<dir>::call(p, buffer);
 
+            util::halo_stats::sent(dir, var, buffer.size() * sizeof(value_type));
+
             hpx::apply(Action(), dest_, buffer, step, var);
         }
 
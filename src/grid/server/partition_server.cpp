@@ -1,6 +1,21 @@
 #include "partition_server.hpp"
 #include "grid/stencils.hpp"
+#include "io/checkpoint.hpp"
+#include "io/snapshot.hpp"
+#include "io/telemetry.hpp"
 #include "io/writer.hpp"
+#include "util/hw_counters.hpp"
+#include "util/phase_timer.hpp"
+#include "util/tau_controller.hpp"
+#include "util/trace.hpp"
+
+#include <hpx/parallel/algorithms/for_loop.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
 
 typedef nast_hpx::grid::server::partition_server partition_component;
 typedef hpx::components::component<partition_component> partition_server_type;
@@ -13,11 +28,27 @@ HPX_REGISTER_ACTION(nast_hpx::grid::server::partition_server::do_timestep_action
     partition_server_do_timestep_action);
 HPX_REGISTER_ACTION(nast_hpx::grid::server::partition_server::init_action,
     partition_server_init_action);
+HPX_REGISTER_ACTION(nast_hpx::grid::server::partition_server::write_checkpoint_action,
+    partition_server_write_checkpoint_action);
+HPX_REGISTER_ACTION(nast_hpx::grid::server::partition_server::flush_output_action,
+    partition_server_flush_output_action);
 
 HPX_REGISTER_GATHER(double, partition_server_residual_gather);
 
+typedef std::vector<char> output_block;
+HPX_REGISTER_GATHER(output_block, partition_server_output_gather);
+
+typedef std::vector<double> monitor_sums;
+HPX_REGISTER_GATHER(monitor_sums, partition_server_monitor_gather);
+
 namespace nast_hpx { namespace grid { namespace server {
 
+template<typename Iter> inline
+Iter safe_advance(Iter it, Iter end, std::size_t stride)
+{
+    return (stride > static_cast<std::size_t>(end - it)) ? end : it + stride;
+}
+
 partition_server::partition_server(io::config const& cfg)
 :   c(cfg),
     cells_x_(c.cells_x_per_partition + 2),
@@ -31,15 +62,14 @@ partition_server::partition_server(io::config const& cfg)
     is_back_(c.idy == c.num_localities_y - 1)
 {
     if (c.verbose)
-        std::cout << "Solver: blockwise Jacobi" << std::endl;
-
-    if (c.verbose)
-        std::cout << "Parellelization: custom grain size" << std::endl;
+        std::cout << "Solver: blockwise Jacobi"
+            << (c.chebyshev ? " with Chebyshev acceleration" : "") << std::endl;
 
     if (c.verbose)
         std::cout << c << std::endl;
 
     step_ = 0;
+    token_step_ = 0;
 
     data_[U].resize(cells_x_, cells_y_, cells_z_, 0);
     data_[V].resize(cells_x_, cells_y_, cells_z_, 0);
@@ -50,6 +80,31 @@ partition_server::partition_server(io::config const& cfg)
     data_[P].resize(cells_x_, cells_y_, cells_z_, 0);
     rhs_data_.resize(cells_x_, cells_y_, cells_z_, 0);
 
+    if (c.chebyshev)
+    {
+        p_jacobi_.resize(cells_x_, cells_y_, cells_z_, 0);
+        p_prev_.resize(cells_x_, cells_y_, cells_z_, 0);
+    }
+
+    spectral_radius_ = c.spectral_radius;
+
+    direct_solver_checked_ = false;
+    direct_solver_ = false;
+    transpose_generation_ = 0;
+
+    // the boundary layers of the domain are inside the edge partitions
+    std::size_t const positions[3] = {c.idx, c.idy, c.idz};
+    std::size_t const partitions[3] = {c.num_localities_x, c.num_localities_y, c.num_localities_z};
+    std::size_t const cells_per_partition[3] =
+        {c.cells_x_per_partition, c.cells_y_per_partition, c.cells_z_per_partition};
+
+    for (std::size_t axis = 0; axis < 3; ++axis)
+    {
+        fluid_origin_[axis] = 1 + (positions[axis] == 0);
+        fluid_extent_[axis] = cells_per_partition[axis]
+            - (positions[axis] == 0) - (positions[axis] == partitions[axis] - 1);
+    }
+
     cell_type_data_.resize(cells_x_, cells_y_, cells_z_);
 
     for (std::size_t k = 1; k < cells_z_ - 1; ++k)
@@ -65,8 +120,227 @@ partition_server::partition_server(io::config const& cfg)
                     obstacle_cells_.emplace_back(i, j, k);
             }
 
-    fluid_stride = fluid_cells_.size() + (fluid_cells_.size() > 0);
-    obstacle_stride = obstacle_cells_.size() + (obstacle_cells_.size() > 0);
+    // every chunk is a single task running its cells sequentially, so the
+    // number of chunks alone determines the parallelism of a stencil sweep
+    if (c.static_chunking)
+        num_chunks_ = c.threads;
+    else if (c.grain_size > 0)
+        num_chunks_ = (fluid_cells_.size() + c.grain_size - 1) / c.grain_size;
+    else
+        num_chunks_ = 4 * c.threads;
+
+    num_chunks_ = std::max<std::size_t>(num_chunks_, 1);
+
+    fluid_stride = (fluid_cells_.size() + num_chunks_ - 1) / num_chunks_;
+    obstacle_stride = (obstacle_cells_.size() + num_chunks_ - 1) / num_chunks_;
+
+    for (std::size_t n = 0; n < c.pressure_extrapolation; ++n)
+        p_history_[n].resize(fluid_cells_.size(), 0);
+
+    if (c.verbose)
+        std::cout << "Parallelization: " << num_chunks_ << " chunks of "
+            << fluid_stride << " fluid cells"
+            << (c.static_chunking ? " (static)" : "") << std::endl;
+}
+
+partition_server::~partition_server()
+{
+    // outputs still being written refer to the staging buffers
+    for (auto& buffer : output_buffers_)
+        if (buffer.written.valid())
+            buffer.written.wait();
+
+    for (auto& written : view_written_)
+        if (written.valid())
+            written.wait();
+
+    if (monitor_written_.valid())
+        monitor_written_.wait();
+}
+
+hpx::future<void> partition_server::write_aggregated(output_buffer& buffer,
+    hpx::shared_future<void> snapshot, std::size_t count)
+{
+    // localities are split into groups of consecutive ranks, the first of
+    // each group collects the blocks and writes them in one piece
+    std::size_t const group_size =
+        (c.num_localities + c.output_aggregators - 1) / c.output_aggregators;
+    std::size_t const first_loc = c.rank / group_size * group_size;
+    std::size_t const members = std::min(group_size, c.num_localities - first_loc);
+
+    std::string const basename = output_basename + std::to_string(first_loc);
+
+    hpx::future<output_block> block = snapshot.then(
+        [this, &buffer](hpx::shared_future<void>)
+        {
+            util::phase_timer::scope timer(util::phase_timer::output);
+            return io::writer::pack_block(buffer.p, buffer.u, buffer.v, buffer.w, cell_type_data_);
+        }
+    );
+
+    if (c.rank != first_loc)
+        return hpx::lcos::gather_there(basename, std::move(block), count, c.rank - first_loc);
+
+    return hpx::lcos::gather_here(basename, std::move(block), members, count)
+        .then(
+            io_executor_,
+            [this, first_loc, count, t = t_](hpx::future<std::vector<output_block> > blocks)
+            {
+                util::phase_timer::scope timer(util::phase_timer::output);
+
+                io::writer::write_aggregated(blocks.get(), first_loc,
+                    c.num_localities_x, c.num_localities_y, c.num_localities_z,
+                    c.i_max, c.j_max, c.k_max,
+                    c.cells_x_per_partition, c.cells_y_per_partition, c.cells_z_per_partition,
+                    c.dx, c.dy, c.dz, t, count);
+            }
+        );
+}
+
+hpx::future<void> partition_server::write_compressed(output_buffer& buffer,
+    hpx::shared_future<void> snapshot, std::size_t count)
+{
+    typedef std::vector<char> compressed_block;
+
+    // the fields are compressed concurrently, each with its staggered axis
+    auto compress =
+        [this, snapshot](partition_data<double> const& data, int staggered_axis)
+        {
+            return snapshot.then(
+                [this, &data, staggered_axis](hpx::shared_future<void>)
+                {
+                    util::phase_timer::scope timer(util::phase_timer::output);
+                    return io::snapshot::compress_field(
+                        io::writer::cell_centered(data, cell_type_data_, staggered_axis),
+                        c.snapshot_error_bound);
+                }
+            );
+        };
+
+    std::vector<hpx::future<compressed_block> > blocks;
+    blocks.push_back(compress(buffer.p, -1));
+    blocks.push_back(compress(buffer.u, 0));
+    blocks.push_back(compress(buffer.v, 1));
+    blocks.push_back(compress(buffer.w, 2));
+
+    hpx::future<compressed_block> flags = hpx::async(
+        [this]()
+        {
+            util::phase_timer::scope timer(util::phase_timer::output);
+            return io::snapshot::compress_flags(io::writer::cell_flags(cell_type_data_));
+        }
+    );
+
+    return hpx::dataflow(
+        io_executor_,
+        hpx::util::unwrapping(
+            [this, count, t = t_](compressed_block const& flags,
+                std::vector<compressed_block> const& fields)
+            {
+                util::phase_timer::scope timer(util::phase_timer::output);
+
+                io::snapshot_header header;
+
+                std::memcpy(header.magic, io::snapshot_magic, sizeof(header.magic));
+                header.i_max = c.i_max;
+                header.j_max = c.j_max;
+                header.k_max = c.k_max;
+                header.cells_x = c.cells_x_per_partition;
+                header.cells_y = c.cells_y_per_partition;
+                header.cells_z = c.cells_z_per_partition;
+                header.idx = c.idx;
+                header.idy = c.idy;
+                header.idz = c.idz;
+                header.res_x = c.num_localities_x;
+                header.res_y = c.num_localities_y;
+                header.res_z = c.num_localities_z;
+                header.deflated = io::snapshot::deflates() ? 1 : 0;
+                header.num_fields = fields.size();
+                header.step = count;
+                header.t = t;
+                header.dx = c.dx;
+                header.dy = c.dy;
+                header.dz = c.dz;
+                header.error_bound = c.snapshot_error_bound;
+
+                std::string filename;
+                filename.append ("./fields/");
+                filename.append ("field_");
+                filename.append (std::to_string(count));
+                filename.append ("_locality_");
+                filename.append (std::to_string(c.rank));
+                filename.append (".nasz");
+
+                io::snapshot::write(filename, header, flags, fields);
+            }
+        ),
+        std::move(flags), std::move(blocks)
+    );
+}
+
+hpx::future<bool> partition_server::write_checkpoint(double dt, std::size_t stepper_step,
+    double tau)
+{
+    return hpx::async(io_executor_,
+        [this, dt, stepper_step, tau]()
+        {
+            io::checkpoint_header header;
+
+            std::memcpy(header.magic, io::checkpoint_magic, sizeof(header.magic));
+            header.num_localities = c.num_localities;
+            header.rank = c.rank;
+            header.i_max = c.i_max;
+            header.j_max = c.j_max;
+            header.k_max = c.k_max;
+            header.num_variables = NUM_VARIABLES;
+            header.cells_x = cells_x_;
+            header.cells_y = cells_y_;
+            header.cells_z = cells_z_;
+            header.x_length = c.x_length;
+            header.y_length = c.y_length;
+            header.z_length = c.z_length;
+            header.t = t_;
+            header.dt = dt;
+            header.next_out = next_out_;
+            header.step = step_;
+            header.stepper_step = stepper_step;
+            header.outcount = outcount_;
+
+            std::vector<std::vector<double> const*> fields;
+            for (std::size_t var = 0; var < NUM_VARIABLES; ++var)
+                fields.push_back(&data_[var].data_);
+
+            std::vector<io::checkpoint_view> views(view_count_.size());
+            for (std::size_t view = 0; view < views.size(); ++view)
+            {
+                views[view].count = view_count_[view];
+                views[view].next_out = view_next_out_[view];
+            }
+
+            return io::checkpoint::write(
+                io::checkpoint::filename(c.checkpoint_dir, stepper_step, c.rank),
+                header, cell_type_data_.data_, fields, views, tau);
+        }
+    );
+}
+
+hpx::future<void> partition_server::flush_output()
+{
+    std::vector<hpx::shared_future<void> > pending(std::move(residual_reductions_));
+    residual_reductions_.clear();
+
+    for (auto const& buffer : output_buffers_)
+        if (buffer.written.valid())
+            pending.push_back(buffer.written);
+
+    for (auto const& written : view_written_)
+        if (written.valid())
+            pending.push_back(written);
+
+    if (monitor_written_.valid())
+        pending.push_back(monitor_written_);
+
+    return static_cast<hpx::future<void> >(hpx::when_all(pending));
 }
 
 void partition_server::init()
@@ -81,6 +355,70 @@ void partition_server::init()
     next_out_ = -1e-12;
     outcount_ = 0;
 
+    for (auto& written : view_written_)
+        written.wait();
+
+    view_pieces_.resize(c.output_views.size());
+    view_written_.assign(c.output_views.size(), hpx::make_ready_future());
+    view_count_.assign(c.output_views.size(), 0);
+    view_next_out_.assign(c.output_views.size(), -1e-12);
+
+    if (monitor_written_.valid())
+        monitor_written_.wait();
+
+    monitor_written_ = hpx::make_ready_future();
+
+    if (c.rank == 0 && !c.monitors.empty())
+        io::writer::write_monitor_header(c.monitor_file, c.monitors, !c.restart_file.empty());
+
+    if (c.rank == 0 && !c.telemetry_file.empty())
+        io::telemetry::open(c.telemetry_file, c.telemetry_buffer, !c.restart_file.empty());
+
+    if (!c.trace_file.empty())
+        util::trace::start(c.trace_file, c.rank, c.trace_events);
+
+    if (c.hw_counters)
+        util::hw_counters::enable(c.machine_balance);
+
+    // continue from the state of the checkpoint instead of the initial one
+    if (!c.restart_file.empty())
+    {
+        std::vector<std::bitset<9> > flags;
+        std::vector<std::vector<double>*> fields;
+
+        for (std::size_t var = 0; var < NUM_VARIABLES; ++var)
+            fields.push_back(&data_[var].data_);
+
+        std::vector<io::checkpoint_view> views;
+
+        io::checkpoint_header header =
+            io::checkpoint::read(c.restart_file, flags, fields, &views);
+
+        step_ = header.step;
+        t_ = header.t;
+        next_out_ = header.next_out;
+        outcount_ = header.outcount;
+
+        // the views are only matched by their position in the config
+        if (views.size() == c.output_views.size())
+        {
+            for (std::size_t view = 0; view < views.size(); ++view)
+            {
+                view_count_[view] = views[view].count;
+                view_next_out_[view] = views[view].next_out;
+            }
+        }
+        else if (c.rank == 0)
+            std::cerr << "Warning: the checkpoint has " << views.size() << " views instead of "
+                << c.output_views.size() << ", the views are written from the start"
+                << std::endl;
+    }
+
+    // the P of a checkpoint is a solution, the initial one is not
+    p_history_count_ = 0;
+    p_history_dt_[0] = p_history_dt_[1] = 0;
+    p_solved_ = !c.restart_file.empty();
+
     std::vector<hpx::future<hpx::id_type > > parts =
         hpx::find_all_from_basename(partition_basename, c.num_localities);
 
@@ -196,22 +534,400 @@ void partition_server::init()
     for (std::size_t var = 0; var < NUM_VARIABLES; ++var)
         recv_futures[var].resize(NUM_DIRECTIONS);
 
-    set_velocity_futures.resize(c.threads);
-    compute_fg_futures.resize(c.threads);
-    compute_rhs_futures.resize(c.threads);
-    set_p_futures.resize(c.threads);
+    set_velocity_futures.resize(num_chunks_);
+    compute_fg_futures.resize(num_chunks_);
+    compute_rhs_futures.resize(num_chunks_);
+    set_p_futures.resize(num_chunks_);
 
-    compute_res_futures.resize(c.threads);
+    compute_res_futures.resize(num_chunks_);
     for (auto& a : compute_res_futures)
         a = hpx::make_ready_future(0.);
 
-    solver_cycle_futures.resize(c.threads);
+    solver_cycle_futures.resize(num_chunks_);
     for (auto& a : solver_cycle_futures)
         a = hpx::make_ready_future();
 
-    local_max_uvs.resize(c.threads);
+    local_max_uvs.resize(num_chunks_);
+    extrapolate_p_futures.resize(num_chunks_);
+    jacobi_sweep_futures.resize(num_chunks_);
 
     token.reset();
+
+    if (c.fft_solver && !direct_solver_checked_)
+    {
+        direct_solver_checked_ = true;
+
+        hpx::future<std::vector<double> > local_box =
+            hpx::make_ready_future(std::vector<double>(1, fluid_box() ? 1. : 0.));
+
+        if (c.rank == 0)
+        {
+            std::vector<std::vector<double> > boxes =
+                hpx::lcos::gather_here(direct_solver_basename, std::move(local_box),
+                    c.num_localities).get();
+
+            bool direct = true;
+
+            for (auto const& box : boxes)
+                direct = direct && box[0] > 0;
+
+            hpx::lcos::broadcast_apply<set_direct_solver_action>(ids_, direct);
+        }
+        else
+            hpx::lcos::gather_there(direct_solver_basename, std::move(local_box)).get();
+
+        direct_solver_ = direct_solver_buffer_.receive(0).get();
+
+        if (direct_solver_)
+        {
+            std::size_t const positions[3] = {c.idx, c.idy, c.idz};
+            std::size_t const cells_per_partition[3] =
+                {c.cells_x_per_partition, c.cells_y_per_partition, c.cells_z_per_partition};
+            std::size_t const cells[3] = {c.i_max, c.j_max, c.k_max};
+            double const h_sq[3] = {c.dx_sq, c.dy_sq, c.dz_sq};
+
+            for (std::size_t axis = 0; axis < 3; ++axis)
+            {
+                dct_[axis] = util::dct(cells[axis]);
+
+                // the transform index of a cell is its global fluid index
+                std::size_t const offset = positions[axis] * cells_per_partition[axis]
+                    + fluid_origin_[axis] - 2;
+
+                eigenvalues_[axis].resize(fluid_extent_[axis]);
+                for (std::size_t s = 0; s < fluid_extent_[axis]; ++s)
+                    eigenvalues_[axis][s] =
+                        (2. * std::cos(M_PI * (offset + s) / cells[axis]) - 2.) / h_sq[axis];
+            }
+
+            dct_block_.resize(fluid_cells_.size());
+        }
+
+        if (c.rank == 0)
+        {
+            if (!direct_solver_)
+                std::cerr << "Warning: the domain has obstacles, fftSolver falls back to the "
+                    "iterative solver" << std::endl;
+            else if (c.verbose)
+                std::cout << "Solver: direct, DCT of " << c.i_max << " x " << c.j_max
+                    << " x " << c.k_max << " cells" << std::endl;
+        }
+    }
+
+    // once per geometry, later runs reuse it
+    if (c.chebyshev && !direct_solver_ && spectral_radius_ == 0)
+    {
+        spectral_radius_ = estimate_spectral_radius();
+
+        if (c.verbose && c.rank == 0)
+            std::cout << "Spectral radius of the Jacobi iteration: " << spectral_radius_
+                << " (estimated from " << c.spectral_radius_iterations << " sweeps)"
+                << std::endl;
+    }
+}
+
+double partition_server::estimate_spectral_radius()
+{
+    // the halos and the gather use generations no pressure solve reaches
+    std::size_t const generation = std::numeric_limits<std::size_t>::max()
+        - c.spectral_radius_iterations;
+
+    std::vector<double> const initial_p = data_[P].data_;
+
+    // pseudo random start from the global position of a cell, so it does not
+    // depend on the decomposition
+    for (auto const& cell : fluid_cells_)
+    {
+        std::uint64_t h = (cell.z + c.idz * c.cells_z_per_partition) * 0x9e3779b97f4a7c15ull
+            ^ (cell.y + c.idy * c.cells_y_per_partition) * 0xbf58476d1ce4e5b9ull
+            ^ (cell.x + c.idx * c.cells_x_per_partition) * 0x94d049bb133111ebull;
+        h ^= h >> 31;
+
+        data_[P](cell.x, cell.y, cell.z) = static_cast<double>(h >> 11) / (1ull << 52) - 1.;
+    }
+
+    // sum and sum of squares of P after the last two sweeps, the constant
+    // mode is removed from the norms on the root
+    std::vector<double> sums(5, 0);
+    sums[4] = static_cast<double>(fluid_cells_.size());
+
+    for (std::size_t iter = 0; iter < c.spectral_radius_iterations; ++iter)
+    {
+        // packed right here, so the sweeps below can not change P under it
+        if (!is_left_)
+            send_buffer_left_(data_[P], generation + iter, P);
+        if (!is_right_)
+            send_buffer_right_(data_[P], generation + iter, P);
+        if (!is_bottom_)
+            send_buffer_bottom_(data_[P], generation + iter, P);
+        if (!is_top_)
+            send_buffer_top_(data_[P], generation + iter, P);
+        if (!is_front_)
+            send_buffer_front_(data_[P], generation + iter, P);
+        if (!is_back_)
+            send_buffer_back_(data_[P], generation + iter, P);
+
+        receive_boundaries_P(recv_futures, generation + iter);
+
+        for (std::size_t dir = 0; dir < NUM_DIRECTIONS; ++dir)
+            if (recv_futures[P][dir].valid())
+                recv_futures[P][dir].wait();
+
+        std::vector<hpx::future<void> > sweeps;
+
+        auto beginObstacle = obstacle_cells_.begin();
+        auto endObstacle = safe_advance(beginObstacle, obstacle_cells_.end(), obstacle_stride);
+
+        for (std::size_t chunk = 0; chunk < num_chunks_; ++chunk)
+        {
+            sweeps.push_back(hpx::async(&stencils<STENCIL_SET_P_OBSTACLE>::call,
+                boost::ref(data_[P]), boost::ref(cell_type_data_), beginObstacle, endObstacle,
+                token));
+
+            beginObstacle = safe_advance(beginObstacle, obstacle_cells_.end(), obstacle_stride);
+            endObstacle = safe_advance(endObstacle, obstacle_cells_.end(), obstacle_stride);
+        }
+
+        hpx::wait_all(sweeps);
+        sweeps.clear();
+
+        // rhs_data_ is still 0 here, so this is the Jacobi iteration matrix
+        auto beginFluid = fluid_cells_.begin();
+        auto endFluid = safe_advance(beginFluid, fluid_cells_.end(), fluid_stride);
+
+        for (std::size_t chunk = 0; chunk < num_chunks_; ++chunk)
+        {
+            sweeps.push_back(hpx::async(&stencils<STENCIL_JACOBI_SWEEP>::call,
+                boost::ref(p_jacobi_), boost::ref(data_[P]), boost::ref(rhs_data_),
+                beginFluid, endFluid, c.dx_sq, c.dy_sq, c.dz_sq, token));
+
+            beginFluid = safe_advance(beginFluid, fluid_cells_.end(), fluid_stride);
+            endFluid = safe_advance(endFluid, fluid_cells_.end(), fluid_stride);
+        }
+
+        hpx::wait_all(sweeps);
+        sweeps.clear();
+
+        // damped by 1/2, the checkerboard mode at -1 can not dominate
+        beginFluid = fluid_cells_.begin();
+        endFluid = safe_advance(beginFluid, fluid_cells_.end(), fluid_stride);
+
+        for (std::size_t chunk = 0; chunk < num_chunks_; ++chunk)
+        {
+            sweeps.push_back(hpx::async(&stencils<STENCIL_CHEBYSHEV>::call,
+                boost::ref(data_[P]), boost::ref(p_prev_), boost::ref(p_jacobi_),
+                beginFluid, endFluid, 0.5, 0.5, token));
+
+            beginFluid = safe_advance(beginFluid, fluid_cells_.end(), fluid_stride);
+            endFluid = safe_advance(endFluid, fluid_cells_.end(), fluid_stride);
+        }
+
+        hpx::wait_all(sweeps);
+
+        if (iter + 2 >= c.spectral_radius_iterations)
+        {
+            std::size_t const offset = iter + 2 == c.spectral_radius_iterations ? 0 : 2;
+
+            for (auto const& cell : fluid_cells_)
+            {
+                double const p = data_[P](cell.x, cell.y, cell.z);
+
+                sums[offset] += p;
+                sums[offset + 1] += p * p;
+            }
+        }
+    }
+
+    hpx::future<std::vector<double> > local_sums = hpx::make_ready_future(sums);
+
+    if (c.rank == 0)
+    {
+        std::vector<std::vector<double> > partial_sums =
+            hpx::lcos::gather_here(spectral_radius_basename, std::move(local_sums),
+                c.num_localities).get();
+
+        std::vector<double> total(5, 0);
+
+        for (auto const& partial : partial_sums)
+            for (std::size_t i = 0; i < total.size(); ++i)
+                total[i] += partial[i];
+
+        double const before = total[1] - total[0] * total[0] / total[4];
+        double const after = total[3] - total[2] * total[2] / total[4];
+
+        // the damped iteration has the eigenvalues (1 + lambda) / 2
+        double rho = before > 0 && after > 0 ? 2. * std::sqrt(after / before) - 1. : 0.;
+        rho = std::min(std::max(rho, 0.), 0.99999);
+
+        hpx::lcos::broadcast_apply<set_spectral_radius_action>(ids_, rho);
+    }
+    else
+        hpx::lcos::gather_there(spectral_radius_basename, std::move(local_sums)).get();
+
+    double const rho = spectral_radius_buffer_.receive(0).get();
+
+    data_[P].data_ = initial_p;
+
+    return rho;
+}
+
+bool partition_server::was_cancelled(std::size_t step)
+{
+    std::lock_guard<std::mutex> l(token_mtx_);
+
+    if (step == token_step_)
+        return token.was_cancelled();
+
+    if (step + 1 == token_step_)
+        return previous_token_.was_cancelled();
+
+    return true;
+}
+
+bool partition_server::fluid_box() const
+{
+    std::size_t count = 0;
+
+    for (std::size_t k = 0; k < fluid_extent_[2]; ++k)
+        for (std::size_t j = 0; j < fluid_extent_[1]; ++j)
+            for (std::size_t i = 0; i < fluid_extent_[0]; ++i)
+                count += cell_type_data_(fluid_origin_[0] + i, fluid_origin_[1] + j,
+                    fluid_origin_[2] + k)[is_fluid];
+
+    return count == fluid_extent_[0] * fluid_extent_[1] * fluid_extent_[2]
+        && count == fluid_cells_.size();
+}
+
+void partition_server::direct_solve()
+{
+    std::size_t const nx = fluid_extent_[0];
+    std::size_t const ny = fluid_extent_[1];
+    std::size_t const nz = fluid_extent_[2];
+
+    for (std::size_t k = 0, n = 0; k < nz; ++k)
+        for (std::size_t j = 0; j < ny; ++j)
+            for (std::size_t i = 0; i < nx; ++i, ++n)
+                dct_block_[n] = rhs_data_(fluid_origin_[0] + i, fluid_origin_[1] + j,
+                    fluid_origin_[2] + k);
+
+    for (std::size_t axis = 0; axis < 3; ++axis)
+        transform_axis(axis, false);
+
+    // the constant mode is only determined up to a constant, it stays 0
+    for (std::size_t k = 0, n = 0; k < nz; ++k)
+        for (std::size_t j = 0; j < ny; ++j)
+            for (std::size_t i = 0; i < nx; ++i, ++n)
+            {
+                double const lambda = eigenvalues_[0][i] + eigenvalues_[1][j] + eigenvalues_[2][k];
+
+                dct_block_[n] = lambda != 0 ? dct_block_[n] / lambda : 0.;
+            }
+
+    for (std::size_t axis = 3; axis-- > 0; )
+        transform_axis(axis, true);
+
+    for (std::size_t k = 0, n = 0; k < nz; ++k)
+        for (std::size_t j = 0; j < ny; ++j)
+            for (std::size_t i = 0; i < nx; ++i, ++n)
+                data_[P](fluid_origin_[0] + i, fluid_origin_[1] + j, fluid_origin_[2] + k) =
+                    dct_block_[n];
+
+    stencils<STENCIL_SET_P_OBSTACLE>::call(data_[P], cell_type_data_,
+        obstacle_cells_.begin(), obstacle_cells_.end(), token);
+}
+
+void partition_server::transform_axis(std::size_t axis, bool inverse)
+{
+    std::size_t const positions[3] = {c.idx, c.idy, c.idz};
+    std::size_t const partitions[3] = {c.num_localities_x, c.num_localities_y, c.num_localities_z};
+    std::size_t const cells_per_partition = axis == 0 ? c.cells_x_per_partition
+        : axis == 1 ? c.cells_y_per_partition : c.cells_z_per_partition;
+
+    std::size_t const members = partitions[axis];
+    std::size_t const me = positions[axis];
+    std::size_t const extent = fluid_extent_[axis];
+    std::size_t const n = dct_[axis].size();
+
+    // a line along the axis starts at line_start and has the stride inner
+    std::size_t const inner = axis == 0 ? 1
+        : axis == 1 ? fluid_extent_[0] : fluid_extent_[0] * fluid_extent_[1];
+    std::size_t const lines = dct_block_.size() / extent;
+
+    auto line_start = [&](std::size_t l) { return (l / inner) * inner * extent + l % inner; };
+    auto first_line = [&](std::size_t m) { return m * lines / members; };
+    auto member_extent = [&](std::size_t m)
+        { return cells_per_partition - (m == 0) - (m == members - 1); };
+    auto member_id = [&](std::size_t m)
+    {
+        std::size_t pos[3] = {c.idx, c.idy, c.idz};
+        pos[axis] = m;
+
+        return ids_[pos[2] * c.num_localities_x * c.num_localities_y
+            + pos[1] * c.num_localities_x + pos[0]];
+    };
+
+    std::size_t const sent = transpose_generation_++;
+    std::size_t const returned = transpose_generation_++;
+
+    // every member transforms a share of the lines, it gets their segments
+    // from all members
+    for (std::size_t m = 0; m < members; ++m)
+    {
+        std::vector<double> segments;
+        segments.reserve((first_line(m + 1) - first_line(m)) * extent);
+
+        for (std::size_t l = first_line(m); l < first_line(m + 1); ++l)
+            for (std::size_t s = 0; s < extent; ++s)
+                segments.push_back(dct_block_[line_start(l) + s * inner]);
+
+        hpx::apply(set_transpose_block_action(), member_id(m), std::move(segments), sent, me);
+    }
+
+    std::size_t const count = first_line(me + 1) - first_line(me);
+    std::vector<double> full_lines(count * n);
+
+    for (std::size_t q = 0, offset = 0; q < members; offset += member_extent(q), ++q)
+    {
+        std::vector<double> segments =
+            transpose_buffer_.receive(sent * c.num_localities + q).get();
+        std::size_t const length = member_extent(q);
+
+        for (std::size_t l = 0; l < count; ++l)
+            std::copy(segments.begin() + l * length, segments.begin() + (l + 1) * length,
+                full_lines.begin() + l * n + offset);
+    }
+
+    hpx::parallel::for_loop(hpx::parallel::execution::par, std::size_t(0), count,
+        [&](std::size_t l)
+        {
+            if (inverse)
+                dct_[axis].inverse(&full_lines[l * n], 1);
+            else
+                dct_[axis].forward(&full_lines[l * n], 1);
+        });
+
+    for (std::size_t q = 0, offset = 0; q < members; offset += member_extent(q), ++q)
+    {
+        std::size_t const length = member_extent(q);
+        std::vector<double> segments(count * length);
+
+        for (std::size_t l = 0; l < count; ++l)
+            std::copy(full_lines.begin() + l * n + offset,
+                full_lines.begin() + l * n + offset + length, segments.begin() + l * length);
+
+        hpx::apply(set_transpose_block_action(), member_id(q), std::move(segments), returned, me);
+    }
+
+    for (std::size_t m = 0; m < members; ++m)
+    {
+        std::vector<double> segments =
+            transpose_buffer_.receive(returned * c.num_localities + m).get();
+
+        for (std::size_t l = first_line(m); l < first_line(m + 1); ++l)
+            for (std::size_t s = 0; s < extent; ++s)
+                dct_block_[line_start(l) + s * inner] =
+                    segments[(l - first_line(m)) * extent + s];
+    }
 }
 
 template<>
@@ -390,7 +1106,8 @@ void partition_server::receive_boundary<LEFT>(std::size_t step, std::size_t var,
                 hpx::util::bind(
                     boost::ref(recv_buffer_left_[var]),
                     boost::ref(data_[var]),
-                    step
+                    step,
+                    var
                 )
             );
 }
@@ -403,7 +1120,8 @@ void partition_server::receive_boundary<RIGHT>(std::size_t step, std::size_t var
                 hpx::util::bind(
                     boost::ref(recv_buffer_right_[var]),
                     boost::ref(data_[var]),
-                    step
+                    step,
+                    var
                 )
             );
 }
@@ -416,7 +1134,8 @@ void partition_server::receive_boundary<BOTTOM>(std::size_t step, std::size_t va
                 hpx::util::bind(
                     boost::ref(recv_buffer_bottom_[var]),
                     boost::ref(data_[var]),
-                    step
+                    step,
+                    var
                 )
             );
 }
@@ -429,7 +1148,8 @@ void partition_server::receive_boundary<TOP>(std::size_t step, std::size_t var,
                 hpx::util::bind(
                     boost::ref(recv_buffer_top_[var]),
                     boost::ref(data_[var]),
-                    step
+                    step,
+                    var
                 )
             );
 }
@@ -442,7 +1162,8 @@ void partition_server::receive_boundary<FRONT>(std::size_t step, std::size_t var
                 hpx::util::bind(
                     boost::ref(recv_buffer_front_[var]),
                     boost::ref(data_[var]),
-                    step
+                    step,
+                    var
                 )
             );
 }
@@ -455,7 +1176,8 @@ void partition_server::receive_boundary<BACK>(std::size_t step, std::size_t var,
                 hpx::util::bind(
                     boost::ref(recv_buffer_back_[var]),
                     boost::ref(data_[var]),
-                    step
+                    step,
+                    var
                 )
             );
 }
@@ -468,7 +1190,8 @@ void partition_server::receive_boundary<BACK_LEFT>(std::size_t step, std::size_t
                 hpx::util::bind(
                     boost::ref(recv_buffer_back_left_[var]),
                     boost::ref(data_[var]),
-                    step
+                    step,
+                    var
                 )
             );
 }
@@ -481,7 +1204,8 @@ void partition_server::receive_boundary<FRONT_RIGHT>(std::size_t step, std::size
                 hpx::util::bind(
                     boost::ref(recv_buffer_front_right_[var]),
                     boost::ref(data_[var]),
-                    step
+                    step,
+                    var
                 )
             );
 }
@@ -494,7 +1218,8 @@ void partition_server::receive_boundary<BOTTOM_RIGHT>(std::size_t step, std::siz
                 hpx::util::bind(
                     boost::ref(recv_buffer_bottom_right_[var]),
                     boost::ref(data_[var]),
-                    step
+                    step,
+                    var
                 )
             );
 }
@@ -507,7 +1232,8 @@ void partition_server::receive_boundary<TOP_LEFT>(std::size_t step, std::size_t
             hpx::util::bind(
                 boost::ref(recv_buffer_top_left_[var]),
                 boost::ref(data_[var]),
-                step
+                step,
+                var
             )
         );
 }
@@ -520,7 +1246,8 @@ void partition_server::receive_boundary<BACK_BOTTOM>(std::size_t step, std::size
             hpx::util::bind(
                 boost::ref(recv_buffer_back_bottom_[var]),
                 boost::ref(data_[var]),
-                step
+                step,
+                var
             )
         );
 }
@@ -533,7 +1260,8 @@ void partition_server::receive_boundary<FRONT_TOP>(std::size_t step, std::size_t
                 hpx::util::bind(
                     boost::ref(recv_buffer_front_top_[var]),
                     boost::ref(data_[var]),
-                    step
+                    step,
+                    var
                 )
             );
 }
@@ -888,10 +1616,124 @@ void partition_server::receive_boundaries_P(future_grid& recv_futures, std::size
         receive_boundary<BACK>(step, P, recv_futures);
 }
 
-template<typename Iter> inline
-Iter safe_advance(Iter it, Iter end, std::size_t stride)
+hpx::shared_future<void> partition_server::extrapolate_p(double dt,
+    hpx::shared_future<void> output_future)
 {
-    return (stride > static_cast<std::size_t>(end - it)) ? end : it + stride;
+    // Lagrange polynomial through the last solves at t - dt_0 - dt_1,
+    // t - dt_0 and t, evaluated at t + dt, the history grows a solve per step
+    std::size_t const order = std::min<std::size_t>(p_history_count_, c.pressure_extrapolation);
+
+    double const a = p_history_dt_[0];
+    double const b = p_history_dt_[1];
+    double p0 = 1, p1 = 0, p2 = 0;
+
+    if (order == 1)
+    {
+        p0 = 1 + dt / a;
+        p1 = -dt / a;
+    }
+    else if (order == 2)
+    {
+        p0 = (dt + a) * (dt + a + b) / (a * (a + b));
+        p1 = -dt * (dt + a + b) / (a * b);
+        p2 = dt * (dt + a) / (b * (a + b));
+    }
+
+    p_history_count_ = std::min<std::size_t>(p_history_count_ + 1, c.pressure_extrapolation);
+
+    auto beginFluid = fluid_cells_.begin();
+    auto endFluid = safe_advance(beginFluid, fluid_cells_.end(), fluid_stride);
+
+    for (std::size_t chunk = 0; chunk < num_chunks_; ++chunk)
+    {
+        std::size_t const offset = beginFluid - fluid_cells_.begin();
+
+        extrapolate_p_futures[chunk] =
+            hpx::dataflow(
+                hpx::util::unwrapping(
+                    util::timed(util::phase_timer::extrapolate_p, util::trace::tags(step_, -1, chunk),
+                        util::counted(util::phase_timer::extrapolate_p, endFluid - beginFluid,
+                            hpx::util::bind(
+                                &stencils<STENCIL_EXTRAPOLATE_P>::call,
+                                boost::ref(data_[P]),
+                                p_history_[0].data() + offset,
+                                c.pressure_extrapolation > 1 ? p_history_[1].data() + offset : nullptr,
+                                beginFluid, endFluid,
+                                p0, p1, p2
+                            )
+                        )
+                    )
+                )
+                , output_future
+                , static_cast<hpx::future<void> >(hpx::when_all(compute_res_futures))
+            );
+
+        beginFluid = safe_advance(beginFluid, fluid_cells_.end(), fluid_stride);
+        endFluid = safe_advance(endFluid, fluid_cells_.end(), fluid_stride);
+    }
+
+    return static_cast<hpx::future<void> >(hpx::when_all(extrapolate_p_futures));
+}
+
+void partition_server::chebyshev_cycle(std::size_t iter, double omega)
+{
+    auto beginFluid = fluid_cells_.begin();
+    auto endFluid = safe_advance(beginFluid, fluid_cells_.end(), fluid_stride);
+
+    for (std::size_t chunk = 0; chunk < num_chunks_; ++chunk)
+    {
+        jacobi_sweep_futures[chunk] =
+            hpx::dataflow(
+                hpx::util::unwrapping(
+                    util::timed(util::phase_timer::jacobi, util::trace::tags(step_, iter, chunk),
+                        util::counted(util::phase_timer::jacobi, endFluid - beginFluid, token,
+                            hpx::util::bind(
+                                &stencils<STENCIL_JACOBI_SWEEP>::call,
+                                boost::ref(p_jacobi_),
+                                boost::ref(data_[P]),
+                                boost::ref(rhs_data_),
+                                beginFluid, endFluid,
+                                c.dx_sq, c.dy_sq, c.dz_sq, token
+                            )
+                        )
+                    )
+                )
+                , static_cast<hpx::future<void> >(hpx::when_all(set_p_futures))
+            );
+
+        beginFluid = safe_advance(beginFluid, fluid_cells_.end(), fluid_stride);
+        endFluid = safe_advance(endFluid, fluid_cells_.end(), fluid_stride);
+    }
+
+    beginFluid = fluid_cells_.begin();
+    endFluid = safe_advance(beginFluid, fluid_cells_.end(), fluid_stride);
+
+    // the sweeps read the neighbors in other chunks, so every chunk of
+    // P is only replaced once all of them are done
+    for (std::size_t chunk = 0; chunk < num_chunks_; ++chunk)
+    {
+        solver_cycle_futures[chunk] =
+            hpx::dataflow(
+                hpx::util::unwrapping(
+                    util::timed(util::phase_timer::chebyshev, util::trace::tags(step_, iter, chunk),
+                        util::counted(util::phase_timer::chebyshev, endFluid - beginFluid, token,
+                            hpx::util::bind(
+                                &stencils<STENCIL_CHEBYSHEV>::call,
+                                boost::ref(data_[P]),
+                                boost::ref(p_prev_),
+                                boost::ref(p_jacobi_),
+                                beginFluid, endFluid,
+                                omega, 0., token
+                            )
+                        )
+                    )
+                )
+                , static_cast<hpx::future<void> >(hpx::when_all(jacobi_sweep_futures))
+            );
+
+        beginFluid = safe_advance(beginFluid, fluid_cells_.end(), fluid_stride);
+        endFluid = safe_advance(endFluid, fluid_cells_.end(), fluid_stride);
+    }
 }
 
 hpx::future<triple<double> > partition_server::do_timestep(double dt)
@@ -899,16 +1741,20 @@ hpx::future<triple<double> > partition_server::do_timestep(double dt)
     auto beginObstacle = obstacle_cells_.begin();
     auto endObstacle = safe_advance(beginObstacle, obstacle_cells_.end(), obstacle_stride);
 
-    for (std::size_t thread = 0; thread < c.threads; ++thread)
+    for (std::size_t chunk = 0; chunk < num_chunks_; ++chunk)
     {
-        set_velocity_futures[thread] =
+        set_velocity_futures[chunk] =
             hpx::async(
-                hpx::util::bind(
-                    &stencils<STENCIL_SET_VELOCITY_OBSTACLE>::call,
-                    boost::ref(data_[U]), boost::ref(data_[V]), boost::ref(data_[W]),
-                    boost::ref(cell_type_data_),
-                    beginObstacle, endObstacle,
-                    boost::ref(c.bnd_condition)
+                util::timed(util::phase_timer::set_velocity, util::trace::tags(step_, -1, chunk),
+                    util::counted(util::phase_timer::set_velocity, endObstacle - beginObstacle,
+                        hpx::util::bind(
+                            &stencils<STENCIL_SET_VELOCITY_OBSTACLE>::call,
+                            boost::ref(data_[U]), boost::ref(data_[V]), boost::ref(data_[W]),
+                            boost::ref(cell_type_data_),
+                            beginObstacle, endObstacle,
+                            boost::ref(c.bnd_condition)
+                        )
+                    )
                 )
             );
 
@@ -925,6 +1771,10 @@ hpx::future<triple<double> > partition_server::do_timestep(double dt)
     send_boundaries_W(set_velocity_futures, step_);
     receive_boundaries_W(recv_futures, step_);
 
+    // the fields are copied into a staging buffer and written on the I/O
+    // pool, only the copy has to finish before the solver writes to P
+    hpx::shared_future<void> output_future = hpx::make_ready_future();
+
     if (c.vtk && next_out_ < t_)
     {
         next_out_ += c.delta_vec;
@@ -932,36 +1782,183 @@ hpx::future<triple<double> > partition_server::do_timestep(double dt)
         if (c.verbose && c.rank == 0)
             std::cout << "Output to .vtk in step " << step_ << std::endl;
 
-        hpx::when_all(set_velocity_futures).then(
-            hpx::launch::async,
-            hpx::util::bind(
-                &io::writer::write_vtk,
-                boost::ref(data_[P]), boost::ref(data_[U]), boost::ref(data_[V]), boost::ref(data_[W]), boost::ref(cell_type_data_),
-                c.num_localities_x, c.num_localities_y, c.num_localities_z, c.i_max, c.j_max, c.k_max, c.dx, c.dx, c.dz, outcount_++,
-                c.rank, c.idx, c.idy, c.idz
-            )
-        ).wait();
+        output_buffer& buffer = output_buffers_[outcount_ % 2];
+
+        if (!buffer.written.valid())
+            buffer.written = hpx::make_ready_future();
+
+        output_future =
+            hpx::dataflow(
+                hpx::util::unwrapping(
+                    [this, &buffer]()
+                    {
+                        util::phase_timer::scope timer(util::phase_timer::output);
+
+                        buffer.p = data_[P];
+                        buffer.u = data_[U];
+                        buffer.v = data_[V];
+                        buffer.w = data_[W];
+                    }
+                )
+                , static_cast<hpx::future<void> >(hpx::when_all(set_velocity_futures))
+                , buffer.written
+            );
+
+        // the flags never change, so they are not copied
+        if (c.aggregated_output)
+            buffer.written = write_aggregated(buffer, output_future, outcount_++);
+        else if (c.compressed_output)
+            buffer.written = write_compressed(buffer, output_future, outcount_++);
+        else
+            buffer.written = output_future.then(
+                io_executor_,
+                util::timed(util::phase_timer::output,
+                    hpx::util::bind(
+                        &io::writer::write_vtk,
+                        boost::ref(buffer.p), boost::ref(buffer.u), boost::ref(buffer.v), boost::ref(buffer.w), boost::ref(cell_type_data_),
+                        c.num_localities_x, c.num_localities_y, c.num_localities_z, c.i_max, c.j_max, c.k_max, c.dx, c.dy, c.dz, outcount_++,
+                        c.rank, c.idx, c.idy, c.idz, c.vtk_binary, c.vtk_float64, c.vtk_compression
+                    )
+                )
+            );
+    }
+
+    // views only copy their samples, localities outside of a view skip it,
+    // except for the root writing the index of the pieces
+    std::vector<hpx::shared_future<void> > sample_futures;
+
+    for (std::size_t view = 0; view < c.output_views.size(); ++view)
+    {
+        if (view_next_out_[view] >= t_)
+            continue;
+
+        view_next_out_[view] += c.output_views[view].interval;
+        std::size_t const count = view_count_[view]++;
+
+        std::size_t first[3], last[3];
+        if (c.rank != 0 && !io::writer::view_range(c.output_views[view],
+                c.cells_x_per_partition, c.cells_y_per_partition, c.cells_z_per_partition,
+                c.idx, c.idy, c.idz, first, last))
+            continue;
+
+        hpx::shared_future<void> sampled =
+            hpx::dataflow(
+                hpx::util::unwrapping(
+                    [this, view]()
+                    {
+                        util::phase_timer::scope timer(util::phase_timer::output);
+
+                        view_pieces_[view] = io::writer::sample_view(c.output_views[view],
+                            data_[P], data_[U], data_[V], data_[W], cell_type_data_,
+                            c.idx, c.idy, c.idz);
+                    }
+                )
+                , static_cast<hpx::future<void> >(hpx::when_all(set_velocity_futures))
+                , view_written_[view]
+            );
+
+        view_written_[view] = sampled.then(
+            io_executor_,
+            [this, view, count](hpx::shared_future<void>)
+            {
+                util::phase_timer::scope timer(util::phase_timer::output);
+
+                io::writer::write_view(c.output_views[view], view_pieces_[view], count, c.rank,
+                    c.num_localities_x, c.num_localities_y, c.num_localities_z,
+                    c.cells_x_per_partition, c.cells_y_per_partition, c.cells_z_per_partition,
+                    c.dx, c.dy, c.dz, c.vtk_float64, c.vtk_compression);
+            }
+        );
+
+        sample_futures.push_back(sampled);
+    }
+
+    // the monitors are reduced like the residual, only the root writes
+    if (!c.monitors.empty() && step_ % c.monitor_interval == 0)
+    {
+        hpx::shared_future<monitor_sums> local_sums =
+            hpx::dataflow(
+                hpx::util::unwrapping(
+                    [this]()
+                    {
+                        util::phase_timer::scope timer(util::phase_timer::output);
+
+                        return io::writer::sum_monitors(c.monitors,
+                            data_[P], data_[U], data_[V], data_[W], cell_type_data_,
+                            c.idx, c.idy, c.idz, c.dx, c.dy, c.dz);
+                    }
+                )
+                , static_cast<hpx::future<void> >(hpx::when_all(set_velocity_futures))
+            );
+
+        hpx::future<monitor_sums> sent = local_sums.then(
+            [](hpx::shared_future<monitor_sums> f)
+            {
+                return f.get();
+            }
+        );
+
+        if (c.rank == 0)
+            monitor_written_ =
+                hpx::dataflow(
+                    io_executor_,
+                    hpx::util::unwrapping(
+                        [this, step = step_, t = t_](std::vector<monitor_sums> partial_sums)
+                        {
+                            monitor_sums sums(partial_sums[0].size(), 0);
+
+                            for (auto const& partial : partial_sums)
+                                for (std::size_t i = 0; i < sums.size(); ++i)
+                                    sums[i] += partial[i];
+
+                            io::writer::append_monitor_values(c.monitor_file, step, t,
+                                io::writer::monitor_values(c.monitors, sums));
+                        }
+                    )
+                    , hpx::lcos::gather_here(monitor_basename, std::move(sent),
+                        c.num_localities, step_)
+                    , monitor_written_
+                );
+        else
+            hpx::lcos::gather_there(monitor_basename, std::move(sent), step_);
+
+        sample_futures.push_back(local_sums.then([](hpx::shared_future<monitor_sums>) {}));
+    }
+
+    // the solver must not touch P before views and monitors are sampled
+    if (!sample_futures.empty())
+    {
+        sample_futures.push_back(output_future);
+        output_future = static_cast<hpx::future<void> >(hpx::when_all(sample_futures));
     }
 
+    // the direct solver does not start from a guess
+    if (c.pressure_extrapolation > 0 && p_solved_ && !direct_solver_)
+        output_future = extrapolate_p(dt, output_future);
+
     auto beginFluid = fluid_cells_.begin();
     auto endFluid = safe_advance(beginFluid, fluid_cells_.end(), fluid_stride);
     beginObstacle = obstacle_cells_.begin();
     endObstacle = safe_advance(beginObstacle, obstacle_cells_.end(), obstacle_stride);
 
-    for (std::size_t thread = 0; thread < c.threads; ++thread)
+    for (std::size_t chunk = 0; chunk < num_chunks_; ++chunk)
     {
-        compute_fg_futures[thread] =
+        compute_fg_futures[chunk] =
             hpx::dataflow(
                 hpx::util::unwrapping(
-                    hpx::util::bind(
-                        &stencils<STENCIL_COMPUTE_FG>::call,
-                        boost::ref(data_[F]), boost::ref(data_[G]), boost::ref(data_[H]),
-                        boost::ref(data_[U]), boost::ref(data_[V]), boost::ref(data_[W]),
-                        boost::ref(cell_type_data_),
-                        beginObstacle, endObstacle,
-                        beginFluid, endFluid,
-                        c.re, c.gx, c.gy, c.gz, c.dx, c.dy, c.dz,
-                        c.dx_sq, c.dy_sq, c.dz_sq, dt, c.alpha
+                    util::timed(util::phase_timer::compute_fg, util::trace::tags(step_, -1, chunk),
+                        util::counted(util::phase_timer::compute_fg, endFluid - beginFluid,
+                            hpx::util::bind(
+                                &stencils<STENCIL_COMPUTE_FG>::call,
+                                boost::ref(data_[F]), boost::ref(data_[G]), boost::ref(data_[H]),
+                                boost::ref(data_[U]), boost::ref(data_[V]), boost::ref(data_[W]),
+                                boost::ref(cell_type_data_),
+                                beginObstacle, endObstacle,
+                                beginFluid, endFluid,
+                                c.re, c.gx, c.gy, c.gz, c.dx, c.dy, c.dz,
+                                c.dx_sq, c.dy_sq, c.dz_sq, dt, c.alpha
+                            )
+                        )
                     )
                 )
                 , static_cast<hpx::future<void> >(hpx::when_all(set_velocity_futures))
@@ -1010,17 +2007,21 @@ hpx::future<triple<double> > partition_server::do_timestep(double dt)
     beginFluid = fluid_cells_.begin();
     endFluid = safe_advance(beginFluid, fluid_cells_.end(), fluid_stride);
 
-    for (std::size_t thread = 0; thread < c.threads; ++thread)
+    for (std::size_t chunk = 0; chunk < num_chunks_; ++chunk)
     {
-        compute_rhs_futures[thread] =
+        compute_rhs_futures[chunk] =
                 hpx::dataflow(
                     hpx::util::unwrapping(
-                        hpx::util::bind(
-                            &stencils<STENCIL_COMPUTE_RHS>::call,
-                            boost::ref(rhs_data_),
-                            boost::ref(data_[F]), boost::ref(data_[G]), boost::ref(data_[H]),
-                            beginFluid, endFluid,
-                            c.dx, c.dy, c.dz, dt
+                        util::timed(util::phase_timer::compute_rhs, util::trace::tags(step_, -1, chunk),
+                            util::counted(util::phase_timer::compute_rhs, endFluid - beginFluid,
+                                hpx::util::bind(
+                                    &stencils<STENCIL_COMPUTE_RHS>::call,
+                                    boost::ref(rhs_data_),
+                                    boost::ref(data_[F]), boost::ref(data_[G]), boost::ref(data_[H]),
+                                    beginFluid, endFluid,
+                                    c.dx, c.dy, c.dz, dt
+                                )
+                            )
                         )
                     )
                     , static_cast<hpx::future<void> >(hpx::when_all(compute_fg_futures))
@@ -1033,27 +2034,55 @@ hpx::future<triple<double> > partition_server::do_timestep(double dt)
         endFluid = safe_advance(endFluid, fluid_cells_.end(), fluid_stride);
     }
 
-    token.reset();
-    for (std::size_t iter = 0; iter < c.iter_max; ++iter)
+    // weight of the Jacobi sweep of the Chebyshev iteration, the first
+    // iteration is a plain Jacobi one
+    double const rho_sq = spectral_radius_ * spectral_radius_;
+    double omega = 1;
+
+    // the direct solver is done after a single pass, its residual is still
+    // reduced for the output and the halos of P
+    std::size_t const iter_max = direct_solver_ ? 1 : c.iter_max;
+
+    // a late cancel of the previous step under dtLookahead must not stop
+    // this one, so every step solves with its own token
+    {
+        std::lock_guard<std::mutex> l(token_mtx_);
+
+        previous_token_ = token;
+        token = util::cancellation_token();
+        token_step_ = step_;
+    }
+
+    residual_reductions_.erase(
+        std::remove_if(residual_reductions_.begin(), residual_reductions_.end(),
+            [](hpx::shared_future<void> const& f) { return f.is_ready(); }),
+        residual_reductions_.end());
+
+    for (std::size_t iter = 0; iter < iter_max; ++iter)
     {
         beginObstacle = obstacle_cells_.begin();
         endObstacle = safe_advance(beginObstacle, obstacle_cells_.end(), obstacle_stride);
 
-        for (std::size_t thread = 0; thread < c.threads; ++thread)
+        for (std::size_t chunk = 0; chunk < num_chunks_; ++chunk)
         {
-            set_p_futures[thread] =
+            set_p_futures[chunk] =
                 hpx::dataflow(
                     hpx::util::unwrapping(
-                        hpx::util::bind(
-                            &stencils<STENCIL_SET_P_OBSTACLE>::call,
-                            boost::ref(data_[P]),
-                            boost::ref(cell_type_data_),
-                            beginObstacle, endObstacle,
-                            token
+                        util::timed(util::phase_timer::set_p, util::trace::tags(step_, iter, chunk),
+                            util::counted(util::phase_timer::set_p, endObstacle - beginObstacle, token,
+                                hpx::util::bind(
+                                    &stencils<STENCIL_SET_P_OBSTACLE>::call,
+                                    boost::ref(data_[P]),
+                                    boost::ref(cell_type_data_),
+                                    beginObstacle, endObstacle,
+                                    token
+                                )
+                            )
                         )
                     )
                     , static_cast<hpx::future<void> >(hpx::when_all(compute_rhs_futures))
                     , static_cast<hpx::future<void> >(hpx::when_all(compute_res_futures))
+                    , output_future
                 );
 
             beginObstacle = safe_advance(beginObstacle, obstacle_cells_.end(), obstacle_stride);
@@ -1061,48 +2090,85 @@ hpx::future<triple<double> > partition_server::do_timestep(double dt)
         }
 
 
-        beginFluid = fluid_cells_.begin();
-        endFluid = safe_advance(beginFluid, fluid_cells_.end(), fluid_stride);
-
-        for (std::size_t thread = 0; thread < c.threads; ++thread)
+        if (direct_solver_)
         {
-            solver_cycle_futures[thread] =
+            hpx::shared_future<void> solved =
                 hpx::dataflow(
                     hpx::util::unwrapping(
-                        hpx::util::bind(
-                            &stencils<STENCIL_JACOBI>::call,
-                            boost::ref(data_[P]),
-                            boost::ref(rhs_data_),
-                            beginFluid, endFluid,
-                            c.dx_sq, c.dy_sq, c.dz_sq, token
+                        util::timed(util::phase_timer::direct_solve, util::trace::tags(step_, iter),
+                            hpx::util::bind(&partition_server::direct_solve, this)
                         )
                     )
                     , static_cast<hpx::future<void> >(hpx::when_all(set_p_futures))
                 );
 
-            beginFluid = safe_advance(beginFluid, fluid_cells_.end(), fluid_stride);
-            endFluid = safe_advance(endFluid, fluid_cells_.end(), fluid_stride);
+            for (auto& solver_cycle : solver_cycle_futures)
+                solver_cycle = solved;
+        }
+        else if (c.chebyshev)
+        {
+            chebyshev_cycle(iter, omega);
+            omega = iter == 0 ? 1. / (1. - rho_sq / 2.) : 1. / (1. - rho_sq * omega / 4.);
+        }
+        else
+        {
+            beginFluid = fluid_cells_.begin();
+            endFluid = safe_advance(beginFluid, fluid_cells_.end(), fluid_stride);
+
+            for (std::size_t chunk = 0; chunk < num_chunks_; ++chunk)
+            {
+                solver_cycle_futures[chunk] =
+                    hpx::dataflow(
+                        hpx::util::unwrapping(
+                            util::timed(util::phase_timer::jacobi, util::trace::tags(step_, iter, chunk),
+                                util::counted(util::phase_timer::jacobi, endFluid - beginFluid, token,
+                                    hpx::util::bind(
+                                        &stencils<STENCIL_JACOBI>::call,
+                                        boost::ref(data_[P]),
+                                        boost::ref(rhs_data_),
+                                        beginFluid, endFluid,
+                                        c.dx_sq, c.dy_sq, c.dz_sq, token
+                                    )
+                                )
+                            )
+                        )
+                        , static_cast<hpx::future<void> >(hpx::when_all(set_p_futures))
+                    );
+
+                beginFluid = safe_advance(beginFluid, fluid_cells_.end(), fluid_stride);
+                endFluid = safe_advance(endFluid, fluid_cells_.end(), fluid_stride);
+            }
         }
 
         send_boundaries_P(solver_cycle_futures, step_ * c.iter_max + iter);
         receive_boundaries_P(recv_futures, step_ * c.iter_max + iter);
 
+        // the residual is only reduced every residualInterval iterations, in
+        // between its tasks cover no cells and just wait for the halos
+        bool const check = (iter + 1) % c.residual_interval == 0 || iter == iter_max - 1;
+
         beginFluid = fluid_cells_.begin();
         endFluid = safe_advance(beginFluid, fluid_cells_.end(), fluid_stride);
 
-        for (std::size_t thread = 0; thread < c.threads; ++thread)
+        for (std::size_t chunk = 0; chunk < num_chunks_; ++chunk)
         {
-            compute_res_futures[thread] =
+            auto const endResidual = check ? endFluid : beginFluid;
+
+            compute_res_futures[chunk] =
                 hpx::dataflow(
                     hpx::util::unwrapping(
-                        hpx::util::bind(
-                            &stencils<STENCIL_COMPUTE_RESIDUAL>::call,
-                            boost::ref(data_[P]),
-                            boost::ref(rhs_data_),
-                            beginFluid, endFluid,
-                            c.dx_sq, c.dy_sq, c.dz_sq, token
+                        util::timed(util::phase_timer::residual, util::trace::tags(step_, iter, chunk),
+                            util::counted(util::phase_timer::residual, endResidual - beginFluid, token,
+                                hpx::util::bind(
+                                    &stencils<STENCIL_COMPUTE_RESIDUAL>::call,
+                                    boost::ref(data_[P]),
+                                    boost::ref(rhs_data_),
+                                    beginFluid, endResidual,
+                                    c.dx_sq, c.dy_sq, c.dz_sq, token
+                                )
                             )
                         )
+                        )
                         , static_cast<hpx::future<void> >(hpx::when_all(solver_cycle_futures))
                         , get_dependency<LEFT>(recv_futures[P])
                         , get_dependency<RIGHT>(recv_futures[P])
@@ -1116,18 +2182,23 @@ hpx::future<triple<double> > partition_server::do_timestep(double dt)
             endFluid = safe_advance(endFluid, fluid_cells_.end(), fluid_stride);
         }
 
+        if (!check)
+            continue;
+
         hpx::future<double> local_residual =
             hpx::dataflow(
                 hpx::util::unwrapping(
-                    [num_fluid_cells = c.num_fluid_cells](std::vector<double> residuals)
-                    -> double
+                    [step = step_, iter](std::vector<double> residuals) -> double
                     {
+                        util::phase_timer::scope timer(util::phase_timer::residual_reduction,
+                            util::trace::tags(step, iter));
+
                         double sum = 0;
 
                         for (std::size_t i = 0; i < residuals.size(); ++i)
                             sum += residuals[i];
 
-                        return sum / num_fluid_cells;
+                        return sum;
                     }
                 )
                 , compute_res_futures
@@ -1140,19 +2211,36 @@ hpx::future<triple<double> > partition_server::do_timestep(double dt)
                                             std::move(local_residual),
                                             c.num_localities, step_ * c.iter_max + iter, 0);
 
-                partial_residuals.then(
+                residual_reductions_.push_back(partial_residuals.then(
                     hpx::util::unwrapping(
-                        [dt, iter_int = iter, step = step_, t = t_, this](std::vector<double> local_residuals)
+                        [dt, iter_int = iter, iter_max, step = step_, t = t_, this](std::vector<double> local_residuals)
                         {
+                            util::phase_timer::scope timer(util::phase_timer::residual_reduction,
+                                util::trace::tags(step, iter_int));
+
                             double residual = 0;
 
                             for (std::size_t i = 0; i < local_residuals.size(); ++i)
                                 residual += local_residuals[i];
 
-                            residual = std::sqrt(residual);
+                            // the global number of fluid cells is only known here
+                            residual = std::sqrt(residual / c.num_fluid_cells);
+
+                            // also drops the late iterations of a converged
+                            // step, their residuals come from cancelled sweeps
+                            if (was_cancelled(step))
+                                return;
+
+                            bool const converged = residual < c.eps || iter_int == iter_max - 1;
+
+                            io::telemetry::record_residual(step, t, dt, iter_int, residual,
+                                converged);
+
+                            if (converged)
+                                util::tau_controller::record_iterations(iter_int + 1,
+                                    residual < c.eps);
 
-                            if ((residual < c.eps || iter_int == c.iter_max - 1)
-                                && !token.was_cancelled())
+                            if (converged)
                             {
                                 if (c.verbose)
                                     std::cout << "step = " << step
@@ -1162,13 +2250,13 @@ hpx::future<triple<double> > partition_server::do_timestep(double dt)
                                         << ", residual = " << residual
                                         << std::endl;
 
-                                hpx::lcos::broadcast_apply<cancel_action>(ids_);
-                                token.cancel();
+                                hpx::lcos::broadcast_apply<cancel_action>(ids_, step);
+                                cancel(step);
                             }
 
                         }
                     )
-                );
+                ));
             }
             // if not root locality, send residual to root locality
             else
@@ -1179,19 +2267,23 @@ hpx::future<triple<double> > partition_server::do_timestep(double dt)
     beginFluid = fluid_cells_.begin();
     endFluid = safe_advance(beginFluid, fluid_cells_.end(), fluid_stride);
 
-    for (std::size_t thread = 0; thread < c.threads; ++thread)
+    for (std::size_t chunk = 0; chunk < num_chunks_; ++chunk)
     {
-       local_max_uvs[thread] =
+       local_max_uvs[chunk] =
             hpx::dataflow(
                 hpx::util::unwrapping(
-                    hpx::util::bind(
-                        &stencils<STENCIL_UPDATE_VELOCITY>::call,
-                        boost::ref(data_[U]), boost::ref(data_[V]), boost::ref(data_[W]),
-                        boost::ref(data_[F]), boost::ref(data_[G]), boost::ref(data_[H]),
-                        boost::ref(data_[P]),
-                        boost::ref(cell_type_data_),
-                        beginFluid, endFluid,
-                        dt, c.over_dx, c.over_dy, c.over_dz
+                    util::timed(util::phase_timer::update_velocity, util::trace::tags(step_, -1, chunk),
+                        util::counted(util::phase_timer::update_velocity, endFluid - beginFluid,
+                            hpx::util::bind(
+                                &stencils<STENCIL_UPDATE_VELOCITY>::call,
+                                boost::ref(data_[U]), boost::ref(data_[V]), boost::ref(data_[W]),
+                                boost::ref(data_[F]), boost::ref(data_[G]), boost::ref(data_[H]),
+                                boost::ref(data_[P]),
+                                boost::ref(cell_type_data_),
+                                beginFluid, endFluid,
+                                dt, c.over_dx, c.over_dy, c.over_dz
+                            )
+                        )
                     )
                 )
                 , static_cast<hpx::future<void> >(hpx::when_all(compute_res_futures))
@@ -1204,9 +2296,11 @@ hpx::future<triple<double> > partition_server::do_timestep(double dt)
     hpx::future<triple<double> > local_max_uv =
         hpx::dataflow(
             hpx::util::unwrapping(
-                [](std::vector<triple<double> > max_uvs)
+                [step = step_](std::vector<triple<double> > max_uvs)
                 -> triple<double>
                 {
+                    util::trace::scope trace("max_velocity_reduction", util::trace::tags(step));
+
                     triple<double> max_uv(0);
 
                     for (std::size_t i = 0; i < max_uvs.size(); ++i)
@@ -1222,6 +2316,10 @@ hpx::future<triple<double> > partition_server::do_timestep(double dt)
             , local_max_uvs
         );
 
+    p_history_dt_[1] = p_history_dt_[0];
+    p_history_dt_[0] = dt;
+    p_solved_ = true;
+
     t_ += dt;
     ++step_;
 
@@ -7,11 +7,15 @@
 #include "grid/direction.hpp"
 
 #include "io/config.hpp"
+#include "io/writer.hpp"
 
 #include "util/cancellation_token.hpp"
+#include "util/dct.hpp"
 
 #include "util/hpx_wrap.hpp"
 
+#include <mutex>
+
 namespace hpx { namespace serialization {
 
 void serialize(input_archive& ar, std::bitset<6>& b, unsigned version)
@@ -33,6 +37,10 @@ namespace nast_hpx { namespace grid { namespace server {
 
 char const* partition_basename = "/nast_hpx/partition/";
 char const* residual_basename = "/nast/hpx/partition/residual";
+char const* output_basename = "/nast_hpx/partition/output/";
+char const* monitor_basename = "/nast_hpx/partition/monitor";
+char const* spectral_radius_basename = "/nast_hpx/partition/spectral_radius";
+char const* direct_solver_basename = "/nast_hpx/partition/direct_solver";
 
 /// component encapsulates partition_data, making it remotely available
 struct HPX_COMPONENT_EXPORT partition_server
@@ -56,7 +64,7 @@ public:
     typedef std::vector<future_vector> future_grid;
 
     partition_server() {}
-    ~partition_server() {}
+    ~partition_server();
 
     partition_server(io::config const& cfg);
 
@@ -67,6 +75,17 @@ public:
     hpx::future<triple<double> > do_timestep(double dt);
     HPX_DEFINE_COMPONENT_ACTION(partition_server, do_timestep, do_timestep_action);
 
+    /// writes the state of the partition into its file of the checkpoint
+    /// taken after the given step, must not overlap with a timestep, false
+    /// if the file is incomplete, tau is the one of the adaptive timestep
+    hpx::future<bool> write_checkpoint(double dt, std::size_t stepper_step, double tau);
+    HPX_DEFINE_COMPONENT_ACTION(partition_server, write_checkpoint, write_checkpoint_action);
+
+    /// ready once the outputs and residual reductions still running are
+    /// done, after the last timestep nothing records events afterwards
+    hpx::future<void> flush_output();
+    HPX_DEFINE_COMPONENT_ACTION(partition_server, flush_output, flush_output_action);
+
     void set_left_boundary(buffer_type buffer, std::size_t step, std::size_t var)
     {
         recv_buffer_left_[var].set_buffer(buffer, step);
@@ -139,12 +158,40 @@ public:
     }
     HPX_DEFINE_COMPONENT_DIRECT_ACTION(partition_server, set_front_top_boundary, set_front_top_boundary_action);
 
-    void cancel()
+    /// stops the pressure solve of the given step, with dtLookahead the
+    /// next step may already be running with its own token
+    void cancel(std::size_t step)
     {
-        token.cancel();
+        std::lock_guard<std::mutex> l(token_mtx_);
+
+        if (step == token_step_)
+            token.cancel();
+        else if (step + 1 == token_step_)
+            previous_token_.cancel();
     }
     HPX_DEFINE_COMPONENT_DIRECT_ACTION(partition_server, cancel, cancel_action);
 
+    void set_spectral_radius(double rho)
+    {
+        spectral_radius_buffer_.store_received(0, std::move(rho));
+    }
+    HPX_DEFINE_COMPONENT_DIRECT_ACTION(partition_server, set_spectral_radius,
+        set_spectral_radius_action);
+
+    void set_direct_solver(bool direct)
+    {
+        direct_solver_buffer_.store_received(0, std::move(direct));
+    }
+    HPX_DEFINE_COMPONENT_DIRECT_ACTION(partition_server, set_direct_solver,
+        set_direct_solver_action);
+
+    void set_transpose_block(std::vector<double> block, std::size_t generation, std::size_t from)
+    {
+        transpose_buffer_.store_received(generation * c.num_localities + from, std::move(block));
+    }
+    HPX_DEFINE_COMPONENT_DIRECT_ACTION(partition_server, set_transpose_block,
+        set_transpose_block_action);
+
     send_buffer<buffer_type, LEFT, set_right_boundary_action> send_buffer_left_;
     recv_buffer<buffer_type, LEFT> recv_buffer_left_[NUM_VARIABLES];
 
@@ -237,23 +284,118 @@ private:
 
     std::vector<hpx::shared_future<void> > set_p_futures;
     std::vector<hpx::shared_future<void> > solver_cycle_futures;
+    std::vector<hpx::shared_future<void> > extrapolate_p_futures;
+    std::vector<hpx::shared_future<void> > jacobi_sweep_futures;
 
     std::vector<hpx::future<triple<double> > > local_max_uvs;
 
     std::vector<hpx::id_type> ids_;
 
+    /// copy of the fields taken for an output, written while the
+    /// simulation goes on
+    struct output_buffer
+    {
+        partition_data<double> p, u, v, w;
+        hpx::shared_future<void> written;
+    };
+
+    /// an output waits for the write two outputs back to finish
+    output_buffer output_buffers_[2];
+    hpx::threads::executors::io_pool_executor io_executor_;
+
+    /// samples of each output view, written on the I/O pool before the
+    /// next samples of the same view are taken
+    std::vector<io::view_piece> view_pieces_;
+    std::vector<hpx::shared_future<void> > view_written_;
+    std::vector<std::size_t> view_count_;
+    std::vector<double> view_next_out_;
+
+    /// the root appends the monitor values of a step once the ones of the
+    /// step before are written
+    hpx::shared_future<void> monitor_written_;
+
+    /// residual reductions of the root that have not finished yet
+    std::vector<hpx::shared_future<void> > residual_reductions_;
+
+    /// gathers the blocks of a group of localities on its aggregator, which
+    /// writes them into the shared field file of the output
+    hpx::future<void> write_aggregated(output_buffer& buffer,
+        hpx::shared_future<void> snapshot, std::size_t count);
+
+    /// compresses the fields of the buffer concurrently on the HPX pool and
+    /// writes the snapshot of the locality on the I/O pool
+    hpx::future<void> write_compressed(output_buffer& buffer,
+        hpx::shared_future<void> snapshot, std::size_t count);
+
+    /// spectral radius of the Jacobi iteration without the constant mode,
+    /// from a power iteration of the damped Jacobi iteration on all
+    /// partitions, the initial P is kept
+    double estimate_spectral_radius();
+
+    /// one Chebyshev iteration on the fluid cells, the Jacobi sweep into
+    /// p_jacobi_ and the update of P and p_prev_ with its weight omega
+    void chebyshev_cycle(std::size_t iter, double omega);
+
+    /// whether the solve of the step is cancelled, also for any step
+    /// before the previous one
+    bool was_cancelled(std::size_t step);
+
+    /// whether all cells inside the domain are fluid on this partition
+    bool fluid_box() const;
+
+    /// solves for P in one pass, DCTs along the three axes diagonalize the
+    /// Laplacian with the Neumann conditions of the walls
+    void direct_solve();
+
+    /// DCT of dct_block_ along an axis, the lines of the partitions along
+    /// the axis are transposed into full lines split among them and back
+    void transform_axis(std::size_t axis, bool inverse);
+
+    /// starts the pressure solve of a step with dt from the extrapolation of
+    /// the last solves, once P is no longer read for the outputs
+    hpx::shared_future<void> extrapolate_p(double dt, hpx::shared_future<void> output_future);
+
     io::config c;
 
     std::size_t cells_x_, cells_y_, cells_z_;
     std::size_t idx_, idy_, idz_;
     std::size_t step_;
     std::size_t outcount_;
+    std::size_t num_chunks_;
     std::size_t fluid_stride;
     std::size_t obstacle_stride;
 
     double t_, next_out_;
 
+    /// P of the last pressureExtrapolation solves, newest first, one value
+    /// per fluid cell, and the dt of the steps that solved them
+    std::vector<double> p_history_[2];
+    std::size_t p_history_count_;
+    double p_history_dt_[2];
+    bool p_solved_;
+
+    /// Jacobi sweep and the iterate before of the Chebyshev solver
+    partition_data<double> p_jacobi_, p_prev_;
+    double spectral_radius_;
+    hpx::lcos::local::receive_buffer<double> spectral_radius_buffer_;
+
+    /// decided once per geometry, the block holds the fluid cells of the
+    /// direct solver, x fastest, starting at the cell fluid_origin_
+    bool direct_solver_checked_;
+    bool direct_solver_;
+    util::dct dct_[3];
+    std::vector<double> eigenvalues_[3];
+    std::vector<double> dct_block_;
+    std::size_t fluid_origin_[3], fluid_extent_[3];
+    std::size_t transpose_generation_;
+    hpx::lcos::local::receive_buffer<std::vector<double> > transpose_buffer_;
+    hpx::lcos::local::receive_buffer<bool> direct_solver_buffer_;
+
+    /// the token of the solve of token_step_ and of the step before
     util::cancellation_token token;
+    util::cancellation_token previous_token_;
+    std::size_t token_step_;
+    std::mutex token_mtx_;
 
     bool is_left_, is_right_, is_bottom_, is_top_, is_front_, is_back_;
 };
@@ -270,4 +412,10 @@ HPX_REGISTER_ACTION_DECLARATION(nast_hpx::grid::server::partition_server::do_tim
 HPX_REGISTER_ACTION_DECLARATION(nast_hpx::grid::server::partition_server::init_action,
                                     partition_server_init_action);
 
+HPX_REGISTER_ACTION_DECLARATION(nast_hpx::grid::server::partition_server::write_checkpoint_action,
+                                    partition_server_write_checkpoint_action);
+
+HPX_REGISTER_ACTION_DECLARATION(nast_hpx::grid::server::partition_server::flush_output_action,
+                                    partition_server_flush_output_action);
+
 #endif
@@ -7,6 +7,7 @@
 #include <hpx/parallel/algorithms/transform_reduce.hpp>
 #include <hpx/parallel/algorithms/for_each.hpp>
 
+#include <algorithm>
 #include <vector>
 
 namespace nast_hpx { namespace grid {
@@ -22,6 +23,9 @@ namespace nast_hpx { namespace grid {
     static const std::size_t STENCIL_COMPUTE_RESIDUAL = 30;
     static const std::size_t STENCIL_UPDATE_VELOCITY = 31;
     static const std::size_t STENCIL_TEST = 32;
+    static const std::size_t STENCIL_EXTRAPOLATE_P = 34;
+    static const std::size_t STENCIL_JACOBI_SWEEP = 35;
+    static const std::size_t STENCIL_CHEBYSHEV = 36;
 
     typedef std::pair<std::size_t, std::size_t> range_type;
 
@@ -54,8 +58,7 @@ namespace nast_hpx { namespace grid {
                 std::vector<index>::iterator endIt,
                 boundary_condition const& bnd_condition)
             {
-                hpx::parallel::for_each(
-                    hpx::parallel::execution::par,
+                std::for_each(
                     beginIt, endIt,
                     [&](index const& ind){
                         auto const i = ind.x;
@@ -328,8 +331,7 @@ namespace nast_hpx { namespace grid {
                 }
             }
 
-            hpx::parallel::for_each(
-                hpx::parallel::execution::par,
+            std::for_each(
                 beginFluid, endFluid,
                 [&](index const& ind){
                     auto const i = ind.x;
@@ -404,8 +406,7 @@ namespace nast_hpx { namespace grid {
                              std::vector<index>::iterator endIt,
                              double dx, double dy, double dz, double dt)
             {
-                hpx::parallel::for_each(
-                    hpx::parallel::execution::par,
+                std::for_each(
                     beginIt, endIt,
                     [&](index const& ind){
                         auto const i = ind.x;
@@ -434,8 +435,7 @@ namespace nast_hpx { namespace grid {
             {
                 if (!token.was_cancelled())
                 {
-                    hpx::parallel::for_each(
-                        hpx::parallel::execution::par,
+                    std::for_each(
                         beginIt, endIt,
                         [&](index const& ind){
                             auto const i = ind.x;
@@ -505,8 +505,7 @@ namespace nast_hpx { namespace grid {
             {
                 if (!token.was_cancelled())
                 {
-                    hpx::parallel::for_each(
-                        hpx::parallel::execution::par,
+                    std::for_each(
                         beginIt, endIt,
                         [&](index const& ind){
                             auto const i = ind.x;
@@ -525,6 +524,70 @@ namespace nast_hpx { namespace grid {
             }
         };
 
+        /// Jacobi update of src_p written to dst_p, src_p stays untouched
+        template<>
+        struct stencils<STENCIL_JACOBI_SWEEP>
+        {
+            static void call(partition_data<double>& dst_p,
+                             partition_data<double> const& src_p,
+                             partition_data<double> const& src_rhs,
+                             std::vector<index>::iterator beginIt,
+                             std::vector<index>::iterator endIt,
+                             double dx_sq, double dy_sq, double dz_sq, util::cancellation_token token)
+            {
+                if (!token.was_cancelled())
+                {
+                    double const factor =
+                        dx_sq * dy_sq * dz_sq / (2. * (dx_sq * dy_sq + dx_sq * dz_sq + dy_sq * dz_sq));
+
+                    for (auto it = beginIt; it < endIt; ++it)
+                    {
+                        auto const i = it->x;
+                        auto const j = it->y;
+                        auto const k = it->z;
+
+                        dst_p(i, j, k) = factor *
+                            ((src_p(i + 1, j, k) + src_p(i - 1, j, k)) / dx_sq
+                             + (src_p(i, j + 1, k) + src_p(i, j - 1, k)) / dy_sq
+                             + (src_p(i, j, k + 1) + src_p(i, j, k - 1)) / dz_sq
+                             - src_rhs(i, j, k));
+                    }
+                }
+            }
+        };
+
+        /// P_new = omega * jacobi + weight * P + (1 - omega - weight) * P_prev,
+        /// with P_prev replaced by P and P by P_new in the same pass
+        template<>
+        struct stencils<STENCIL_CHEBYSHEV>
+        {
+            static void call(partition_data<double>& dst_p,
+                             partition_data<double>& dst_p_prev,
+                             partition_data<double> const& src_jacobi,
+                             std::vector<index>::iterator beginIt,
+                             std::vector<index>::iterator endIt,
+                             double omega, double weight, util::cancellation_token token)
+            {
+                if (!token.was_cancelled())
+                {
+                    double const prev_weight = 1. - omega - weight;
+
+                    for (auto it = beginIt; it < endIt; ++it)
+                    {
+                        auto const i = it->x;
+                        auto const j = it->y;
+                        auto const k = it->z;
+
+                        double const current = dst_p(i, j, k);
+
+                        dst_p(i, j, k) = omega * src_jacobi(i, j, k) + weight * current
+                            + prev_weight * dst_p_prev(i, j, k);
+                        dst_p_prev(i, j, k) = current;
+                    }
+                }
+            }
+        };
+
         template<>
         struct stencils<STENCIL_COMPUTE_RESIDUAL>
         {
@@ -537,24 +600,20 @@ namespace nast_hpx { namespace grid {
                 double local_residual = 0;
                 if (!token.was_cancelled())
                 {
-                    local_residual = hpx::parallel::transform_reduce(
-                        hpx::parallel::execution::par,
-                        beginIt, endIt,
-                        0.0,
-                        [](double const a, double const b)
-                        { return a + b; },
-                        [&](index const& ind) {
-                            auto const i = ind.x;
-                            auto const j = ind.y;
-                            auto const k = ind.z;
+                    for (auto it = beginIt; it < endIt; ++it)
+                    {
+                        auto const i = it->x;
+                        auto const j = it->y;
+                        auto const k = it->z;
 
-                            double tmp =
-                                (src_p(i + 1, j, k) - 2 * src_p(i, j, k) + src_p(i - 1, j, k)) / over_dx_sq
-                                + (src_p(i, j + 1, k) - 2 * src_p(i, j, k) + src_p(i, j - 1, k)) / over_dy_sq
-                                + (src_p(i, j, k + 1) - 2 * src_p(i, j, k) + src_p(i, j, k - 1)) / over_dz_sq
-                                - src_rhs(i, j, k);
-                            return tmp * tmp;
-                        });
+                        double tmp =
+                            (src_p(i + 1, j, k) - 2 * src_p(i, j, k) + src_p(i - 1, j, k)) / over_dx_sq
+                            + (src_p(i, j + 1, k) - 2 * src_p(i, j, k) + src_p(i, j - 1, k)) / over_dy_sq
+                            + (src_p(i, j, k + 1) - 2 * src_p(i, j, k) + src_p(i, j, k - 1)) / over_dz_sq
+                            - src_rhs(i, j, k);
+
+                        local_residual += tmp * tmp;
+                    }
                 }
                 return local_residual;
             }
@@ -576,47 +635,87 @@ namespace nast_hpx { namespace grid {
             double dt, double over_dx, double over_dy, double over_dz
             )
         {
-            triple<double> max_uvw = hpx::parallel::transform_reduce(
-                hpx::parallel::execution::par,
-                beginIt, endIt,
-                triple<double>(0.0, 0.0, 0.0),
-                [](triple<double> const& a, triple<double> const& b) -> triple<double> {
-                    return triple<double>(a.x > b.x ? a.x : b.x,
-                                          a.y > b.y ? a.y : b.y,
-                                          a.z > b.z ? a.z : b.z );
-                },
-                [&](index const& ind) -> triple<double> {
-                    auto const i = ind.x;
-                    auto const j = ind.y;
-                    auto const k = ind.z;
+            triple<double> max_uvw(0.0, 0.0, 0.0);
 
-                    auto const& cell_type = cell_types(i, j, k);
+            for (auto it = beginIt; it < endIt; ++it)
+            {
+                auto const i = it->x;
+                auto const j = it->y;
+                auto const k = it->z;
 
-                    if (cell_type[has_fluid_right])
-                    {
-                        dst_u(i, j, k) = src_f(i, j, k) - dt * over_dx *
-                            (src_p(i + 1, j, k) - src_p(i, j, k));
-                    }
+                auto const& cell_type = cell_types(i, j, k);
 
-                    if (cell_type[has_fluid_back])
-                    {
-                        dst_v(i, j, k) = src_g(i, j, k) - dt * over_dy *
-                            (src_p(i, j + 1, k) - src_p(i, j, k));
-                    }
+                if (cell_type[has_fluid_right])
+                {
+                    dst_u(i, j, k) = src_f(i, j, k) - dt * over_dx *
+                        (src_p(i + 1, j, k) - src_p(i, j, k));
+                }
 
-                    if (cell_type[has_fluid_top])
-                    {
-                        dst_w(i, j, k) = src_h(i, j, k) - dt * over_dz *
-                            (src_p(i, j, k + 1) - src_p(i, j, k));
-                    }
+                if (cell_type[has_fluid_back])
+                {
+                    dst_v(i, j, k) = src_g(i, j, k) - dt * over_dy *
+                        (src_p(i, j + 1, k) - src_p(i, j, k));
+                }
+
+                if (cell_type[has_fluid_top])
+                {
+                    dst_w(i, j, k) = src_h(i, j, k) - dt * over_dz *
+                        (src_p(i, j, k + 1) - src_p(i, j, k));
+                }
+
+                max_uvw.x = std::max(max_uvw.x, std::abs(dst_u(i, j, k)));
+                max_uvw.y = std::max(max_uvw.y, std::abs(dst_v(i, j, k)));
+                max_uvw.z = std::max(max_uvw.z, std::abs(dst_w(i, j, k)));
+            }
 
-                    return triple<double>(std::abs(dst_u(i, j, k)),
-                                          std::abs(dst_v(i, j, k)),
-                                          std::abs(dst_w(i, j, k)));
-                });
             return max_uvw;
         }
     };
+
+    /// replaces P by p0 * P + p1 * P_1 + p2 * P_2 and shifts the history of
+    /// the cells in one pass, the history holds one value per fluid cell in
+    /// the order of the cells, starting at the first cell of the range
+    template<>
+    struct stencils<STENCIL_EXTRAPOLATE_P>
+    {
+        static void call(partition_data<double>& dst_p,
+            double* history_1, double* history_2,
+            std::vector<index>::iterator beginIt,
+            std::vector<index>::iterator endIt,
+            double p0, double p1, double p2)
+        {
+            std::size_t const count = endIt - beginIt;
+
+            if (count == 0)
+                return;
+
+            index const* cells = &*beginIt;
+
+            if (history_2 == nullptr)
+            {
+                for (std::size_t n = 0; n < count; ++n)
+                {
+                    double& p = dst_p(cells[n].x, cells[n].y, cells[n].z);
+                    double const current = p;
+
+                    p = p0 * current + p1 * history_1[n];
+                    history_1[n] = current;
+                }
+            }
+            else
+            {
+                for (std::size_t n = 0; n < count; ++n)
+                {
+                    double& p = dst_p(cells[n].x, cells[n].y, cells[n].z);
+                    double const current = p;
+
+                    p = p0 * current + p1 * history_1[n] + p2 * history_2[n];
+                    history_2[n] = history_1[n];
+                    history_1[n] = current;
+                }
+            }
+        }
+    };
 }
 }
 
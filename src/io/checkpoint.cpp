@@ -0,0 +1,254 @@
+#include "checkpoint.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+namespace nast_hpx { namespace io {
+
+namespace {
+
+    std::string step_dir(std::string const& dir, std::size_t step)
+    {
+        return dir + "/step_" + std::to_string(step);
+    }
+
+    bool make_dir(std::string const& path)
+    {
+        return mkdir(path.c_str(), 0755) == 0 || errno == EEXIST;
+    }
+}
+
+std::string checkpoint::filename(std::string const& dir, std::size_t step, std::size_t rank)
+{
+    return step_dir(dir, step) + "/locality_" + std::to_string(rank) + ".ckp";
+}
+
+std::string checkpoint::latest(std::string const& dir, std::size_t rank)
+{
+    std::ifstream file(dir + "/latest");
+    std::size_t step;
+
+    if (!(file >> step))
+    {
+        std::cerr << "Error: no complete checkpoint in " << dir << "!" << std::endl;
+        std::exit(1);
+    }
+
+    return filename(dir, step, rank);
+}
+
+checkpoint_header checkpoint::read_header(std::string const& path)
+{
+    std::ifstream file(path, std::ios::binary);
+
+    checkpoint_header header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+    if (!file || std::memcmp(header.magic, checkpoint_magic, sizeof(checkpoint_magic)) != 0)
+    {
+        std::cerr << "Error: " << path << " is not a checkpoint!" << std::endl;
+        std::exit(1);
+    }
+
+    return header;
+}
+
+bool checkpoint::write(std::string const& path, checkpoint_header const& header,
+    std::vector<std::bitset<9> > const& flags,
+    std::vector<std::vector<double> const*> const& variables,
+    std::vector<checkpoint_view> const& views, double tau)
+{
+    std::string const dir = path.substr(0, path.rfind('/'));
+    make_dir(dir.substr(0, dir.rfind('/')));
+
+    if (!make_dir(dir))
+    {
+        std::cerr << "Error: could not create " << dir << "!" << std::endl;
+        return false;
+    }
+
+    std::string const tmp_path = path + ".tmp";
+
+    {
+        std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+
+        file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+
+        std::vector<std::uint16_t> packed_flags(flags.size());
+        for (std::size_t i = 0; i < flags.size(); ++i)
+            packed_flags[i] = static_cast<std::uint16_t>(flags[i].to_ulong());
+
+        file.write(reinterpret_cast<char const*>(packed_flags.data()),
+            packed_flags.size() * sizeof(std::uint16_t));
+
+        for (auto variable : variables)
+            file.write(reinterpret_cast<char const*>(variable->data()),
+                variable->size() * sizeof(double));
+
+        std::uint64_t const num_views = views.size();
+        file.write(reinterpret_cast<char const*>(&num_views), sizeof(num_views));
+
+        for (auto const& view : views)
+            file.write(reinterpret_cast<char const*>(&view.count), sizeof(view.count));
+        for (auto const& view : views)
+            file.write(reinterpret_cast<char const*>(&view.next_out), sizeof(view.next_out));
+
+        file.write(reinterpret_cast<char const*>(&tau), sizeof(tau));
+
+        // a full disk may only show when the buffer is flushed
+        file.close();
+
+        if (!file)
+        {
+            std::cerr << "Error: could not write checkpoint " << path << "!" << std::endl;
+            std::remove(tmp_path.c_str());
+            return false;
+        }
+    }
+
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0)
+    {
+        std::cerr << "Error: could not rename checkpoint " << tmp_path << "!" << std::endl;
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+checkpoint_header checkpoint::read(std::string const& path, std::vector<std::bitset<9> >& flags,
+    std::vector<std::vector<double>*> const& variables,
+    std::vector<checkpoint_view>* views)
+{
+    checkpoint_header header = read_header(path);
+
+    std::size_t const size = header.cells_x * header.cells_y * header.cells_z;
+
+    std::ifstream file(path, std::ios::binary);
+    file.seekg(sizeof(header));
+
+    std::vector<std::uint16_t> packed_flags(size);
+    file.read(reinterpret_cast<char*>(packed_flags.data()), size * sizeof(std::uint16_t));
+
+    flags.resize(size);
+    for (std::size_t i = 0; i < size; ++i)
+        flags[i] = std::bitset<9>(packed_flags[i]);
+
+    if (!variables.empty() && variables.size() != header.num_variables)
+    {
+        std::cerr << "Error: checkpoint " << path << " holds " << header.num_variables
+            << " fields instead of " << variables.size() << "!" << std::endl;
+        std::exit(1);
+    }
+
+    for (auto variable : variables)
+    {
+        variable->resize(size);
+        file.read(reinterpret_cast<char*>(variable->data()), size * sizeof(double));
+    }
+
+    if (!file)
+    {
+        std::cerr << "Error: checkpoint " << path << " is truncated!" << std::endl;
+        std::exit(1);
+    }
+
+    if (views == nullptr || variables.empty())
+        return header;
+
+    views->clear();
+
+    std::uint64_t num_views;
+    if (!file.read(reinterpret_cast<char*>(&num_views), sizeof(num_views)))
+        return header;
+
+    views->resize(num_views);
+
+    for (auto& view : *views)
+        file.read(reinterpret_cast<char*>(&view.count), sizeof(view.count));
+    for (auto& view : *views)
+        file.read(reinterpret_cast<char*>(&view.next_out), sizeof(view.next_out));
+
+    if (!file)
+    {
+        std::cerr << "Error: checkpoint " << path << " is truncated!" << std::endl;
+        std::exit(1);
+    }
+
+    return header;
+}
+
+bool checkpoint::read_tau(std::string const& path, double& tau)
+{
+    checkpoint_header const header = read_header(path);
+
+    std::size_t const size = header.cells_x * header.cells_y * header.cells_z;
+
+    std::ifstream file(path, std::ios::binary);
+    file.seekg(sizeof(header) + size * sizeof(std::uint16_t)
+        + header.num_variables * size * sizeof(double));
+
+    std::uint64_t num_views;
+    if (!file.read(reinterpret_cast<char*>(&num_views), sizeof(num_views)))
+        return false;
+
+    file.seekg(num_views * (sizeof(std::uint64_t) + sizeof(double)), std::ios::cur);
+
+    double value;
+    if (!file.read(reinterpret_cast<char*>(&value), sizeof(value)))
+        return false;
+
+    tau = value;
+    return true;
+}
+
+bool checkpoint::commit(std::string const& dir, std::size_t step, std::size_t previous_step,
+    std::size_t num_localities)
+{
+    std::string const tmp_path = dir + "/latest.tmp";
+
+    {
+        std::ofstream file(tmp_path, std::ios::trunc);
+        file << step << std::endl;
+        file.close();
+
+        if (!file)
+        {
+            std::cerr << "Error: could not write " << tmp_path << "!" << std::endl;
+            std::remove(tmp_path.c_str());
+            return false;
+        }
+    }
+
+    // latest still names the previous checkpoint, so it has to stay
+    if (std::rename(tmp_path.c_str(), (dir + "/latest").c_str()) != 0)
+    {
+        std::cerr << "Error: could not rename " << tmp_path << "!" << std::endl;
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+
+    if (previous_step != step)
+        discard(dir, previous_step, num_localities);
+
+    return true;
+}
+
+void checkpoint::discard(std::string const& dir, std::size_t step, std::size_t num_localities)
+{
+    for (std::size_t rank = 0; rank < num_localities; ++rank)
+        std::remove(filename(dir, step, rank).c_str());
+
+    rmdir(step_dir(dir, step).c_str());
+}
+
+}
+}
@@ -0,0 +1,94 @@
+#ifndef NAST_HPX_IO_CHECKPOINT_HPP_
+#define NAST_HPX_IO_CHECKPOINT_HPP_
+
+#include <bitset>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace nast_hpx { namespace io {
+
+/// First bytes of a checkpoint file.
+char const checkpoint_magic[8] = {'N', 'A', 'S', 'T', 'C', 'K', 'P', '1'};
+
+/// Header of the checkpoint file of a single locality. It is followed by
+/// the uint16_t flags and the num_variables fields of the partition,
+/// including the halo layer, as double, the output state of the views and
+/// the safety factor tau of the timestep.
+struct checkpoint_header
+{
+    char magic[8];
+
+    std::uint32_t num_localities;
+    std::uint32_t rank;
+    std::uint32_t i_max;
+    std::uint32_t j_max;
+    std::uint32_t k_max;
+    std::uint32_t num_variables;
+
+    std::uint64_t cells_x;
+    std::uint64_t cells_y;
+    std::uint64_t cells_z;
+
+    double x_length;
+    double y_length;
+    double z_length;
+
+    double t;
+    double dt;
+    double next_out;
+
+    std::uint64_t step;
+    std::uint64_t stepper_step;
+    std::uint64_t outcount;
+};
+
+/// Output state of a view, stored after the fields as the uint64_t number
+/// of views, their counts and their next output times, followed by tau as
+/// double. Older checkpoints end with the fields or the views.
+struct checkpoint_view
+{
+    std::uint64_t count;
+    double next_out;
+};
+
+/// Checkpoints are kept in <dir>/step_<n>/locality_<rank>.ckp, <dir>/latest
+/// names the last complete one.
+struct checkpoint
+{
+    static std::string filename(std::string const& dir, std::size_t step, std::size_t rank);
+
+    /// returns the file of the given locality in the latest complete checkpoint
+    static std::string latest(std::string const& dir, std::size_t rank);
+
+    static checkpoint_header read_header(std::string const& path);
+
+    /// false if the file could not be written completely
+    static bool write(std::string const& path, checkpoint_header const& header,
+        std::vector<std::bitset<9> > const& flags,
+        std::vector<std::vector<double> const*> const& variables,
+        std::vector<checkpoint_view> const& views, double tau);
+
+    /// reads the flags and, if variables is not empty, the fields and the
+    /// views, which stay empty for a checkpoint without them
+    static checkpoint_header read(std::string const& path, std::vector<std::bitset<9> >& flags,
+        std::vector<std::vector<double>*> const& variables,
+        std::vector<checkpoint_view>* views = nullptr);
+
+    /// the tau the run had reached, false for a checkpoint without it
+    static bool read_tau(std::string const& path, double& tau);
+
+    /// marks the checkpoint of the given step as complete and removes the
+    /// one of previous_step, called once all localities have written theirs,
+    /// false if latest could not be updated, the previous one is kept then
+    static bool commit(std::string const& dir, std::size_t step, std::size_t previous_step,
+        std::size_t num_localities);
+
+    /// removes the files of the checkpoint of the given step
+    static void discard(std::string const& dir, std::size_t step, std::size_t num_localities);
+};
+
+}
+}
+
+#endif
@@ -1,9 +1,11 @@
 #include "config.hpp"
+#include "checkpoint.hpp"
+#include "geometry.hpp"
+#include "grid_reader.hpp"
 
 #include "pugixml/pugixml.hpp"
 
-#include <sstream>
-#include <fstream>
+#include <algorithm>
 #include <string>
 #include <cstdlib>
 #include <cmath>
@@ -11,7 +13,7 @@
 namespace nast_hpx { namespace io {
     /// Methods reads the simulation configuration from the given file
     /// and returns a corresponding config object.
-    config config::read_config_from_file(const char *xml_path, const char *grid_path, std::size_t rank, std::size_t num_localities)
+    config config::read_config_from_file(const char *xml_path, const char *grid_path, const char *restart_dir, std::size_t rank, std::size_t num_localities)
     {
         config cfg;
         cfg.num_localities = num_localities;
@@ -21,35 +23,81 @@ namespace nast_hpx { namespace io {
         cfg.num_localities_y = cfg.num_localities_x;
         cfg.num_localities_z = cfg.num_localities_x;
 
-//-------------------------------------------------- GRID --------------------------------------------------//
+        pugi::xml_document doc;
+        pugi::xml_parse_result result = doc.load_file(xml_path);
 
-        std::ifstream file(grid_path);
+        if (!result) {
+            std::cerr << "Error loading file: " << xml_path << std::endl;
+            std::exit(1);
+        }
 
-        if (!file)
-        {
-            std::cerr << "Could not open grid file at " << grid_path << "!" << std::endl;
+        pugi::xml_node config_node = doc.child("SimulationConfig");
+        if (config_node == NULL) {
+            std::cerr
+                << "Error: A simulation configuration must be defined!"
+                << std::endl;
             std::exit(1);
         }
 
-        std::string cfg_line;
+//-------------------------------------------------- GRID --------------------------------------------------//
 
-        std::getline(file, cfg_line);
-        cfg.i_max = std::stoi(cfg_line);
+        // on restart the flags are taken from the checkpoint, without a grid
+        // file they are generated from the Geometry section
+        bool const restart = (restart_dir != NULL && restart_dir[0] != '\0');
+        bool const procedural = !restart && (grid_path == NULL || grid_path[0] == '\0');
 
-        std::getline(file, cfg_line);
-        cfg.j_max = std::stoi(cfg_line);
+        grid_header header;
+        geometry geo;
+        checkpoint_header ckp_header;
 
-        std::getline(file, cfg_line);
-        cfg.k_max = std::stoi(cfg_line);
+        if (restart)
+        {
+            cfg.restart_file = checkpoint::latest(restart_dir, rank);
+            ckp_header = checkpoint::read_header(cfg.restart_file);
 
-        std::getline(file, cfg_line);
-        cfg.x_length = std::stod(cfg_line);
+            if (ckp_header.num_localities != num_localities)
+            {
+                std::cerr << "Error: checkpoint was written by " << ckp_header.num_localities
+                    << " localities, restart needs the same number!" << std::endl;
+                std::exit(1);
+            }
 
-        std::getline(file, cfg_line);
-        cfg.y_length = std::stod(cfg_line);
+            header.i_max = ckp_header.i_max;
+            header.j_max = ckp_header.j_max;
+            header.k_max = ckp_header.k_max;
 
-        std::getline(file, cfg_line);
-        cfg.z_length = std::stod(cfg_line);
+            header.x_length = ckp_header.x_length;
+            header.y_length = ckp_header.y_length;
+            header.z_length = ckp_header.z_length;
+        }
+        else if (procedural)
+        {
+            if (config_node.child("Geometry") == NULL)
+            {
+                std::cerr << "Error: Neither a grid file nor a Geometry given!" << std::endl;
+                std::exit(1);
+            }
+
+            geo = geometry::read(config_node.child("Geometry"));
+
+            header.i_max = geo.i_max;
+            header.j_max = geo.j_max;
+            header.k_max = geo.k_max;
+
+            header.x_length = geo.x_length;
+            header.y_length = geo.y_length;
+            header.z_length = geo.z_length;
+        }
+        else
+            header = grid_reader::read_header(grid_path);
+
+        cfg.i_max = header.i_max;
+        cfg.j_max = header.j_max;
+        cfg.k_max = header.k_max;
+
+        cfg.x_length = header.x_length;
+        cfg.y_length = header.y_length;
+        cfg.z_length = header.z_length;
 
         cfg.cells_x_per_partition = (cfg.i_max + 2) / cfg.num_localities_x;
 
@@ -94,103 +142,30 @@ namespace nast_hpx { namespace io {
         cfg.over_dy_sq = 1. / cfg.dy_sq;
         cfg.over_dz_sq = 1. / cfg.dz_sq;
 
-        std::size_t flag_res_x = cfg.cells_x_per_partition + 2;
-        std::size_t flag_res_y = cfg.cells_y_per_partition + 2;
-        std::size_t flag_res_z = cfg.cells_y_per_partition + 2;
-
-        cfg.flag_grid.resize(flag_res_x * flag_res_y * flag_res_z);
-
         std::size_t idx = (rank % (cfg.num_localities_x * cfg.num_localities_y)) % cfg.num_localities_x;
         std::size_t idy = (rank % (cfg.num_localities_x * cfg.num_localities_y)) / cfg.num_localities_x;
         std::size_t idz = rank / (cfg.num_localities_x * cfg.num_localities_y);
 
-        std::size_t start_i = idx * cfg.cells_x_per_partition;
-        std::size_t end_i = start_i + cfg.cells_x_per_partition;
-
-        std::size_t start_j = idy * cfg.cells_y_per_partition;
-        std::size_t end_j = start_j + cfg.cells_y_per_partition;
-
-        std::size_t start_k = idz * cfg.cells_z_per_partition;
-        std::size_t end_k = start_k + cfg.cells_z_per_partition;
-
-        std::size_t insert_i = 0;
-        std::size_t insert_j = (end_j - start_j) - 1;
-        std::size_t insert_k = 0;
-
-        std::size_t i, j, k;
-        i = 0;
-        j = cfg.j_max + 1;
-        k = 0;
-
-        cfg.num_fluid_cells = 0;
-
-        while (true)
+        // only the cells of this partition are loaded, the global number of
+        // fluid cells is reduced on the root locality once all are loaded
+        if (restart)
         {
-            std::string line;
-            std::getline(file, line);
-
-            if (!file.good())
-                break;
-
-            std::stringstream iss(line);
-            i = 0;
-            insert_i = 0;
-            while (true)
-            {
-                std::string cell_val;
-                std::getline(iss, cell_val, ',');
-
-                std::bitset<9> flag(std::stoi(cell_val));
+            checkpoint::read(cfg.restart_file, cfg.flag_grid, std::vector<std::vector<double>*>());
 
+            cfg.num_local_fluid_cells = 0;
+            for (auto const& flag : cfg.flag_grid)
                 if (flag.test(is_fluid))
-                    cfg.num_fluid_cells++;
-
-                if (i >= start_i && i < end_i && j >= start_j && j < end_j && k >= start_k && k < end_k)
-                {
-                    cfg.flag_grid[(1 + insert_k) * flag_res_x * flag_res_y + (insert_j + 1)* flag_res_x + insert_i + 1] = flag;
-                    ++insert_i;
-                }
-
-                if (!iss.good())
-                    break;
-                ++i;
-            }
-
-            if (j >= start_j && j < end_j)
-                --insert_j;
-
-            if (j == 0)
-            {
-                insert_i = 0;
-                insert_j = (end_j - start_j) - 1;
-                j = cfg.j_max + 1;
-
-                if (k >= start_k && k < end_k)
-                    ++insert_k;
-
-                ++k;
-            } else
-                --j;
+                    ++cfg.num_local_fluid_cells;
         }
+        else if (procedural)
+            cfg.num_local_fluid_cells = geo.rasterize(cfg, idx, idy, idz);
+        else
+            cfg.num_local_fluid_cells =
+                grid_reader::read_partition(grid_path, header, cfg, idx, idy, idz, rank == 0);
+        cfg.num_fluid_cells = cfg.num_local_fluid_cells;
 
 //-------------------------------------------------- CONFIG --------------------------------------------------//
 
-        pugi::xml_document doc;
-        pugi::xml_parse_result result = doc.load_file(xml_path);
-
-        if (!result) {
-            std::cerr << "Error loading file: " << xml_path << std::endl;
-            std::exit(1);
-        }
-
-        pugi::xml_node config_node = doc.child("SimulationConfig");
-        if (config_node == NULL) {
-            std::cerr
-                << "Error: A simulation configuration must be defined!"
-                << std::endl;
-            std::exit(1);
-        }
-
         if(config_node.child("Re") != NULL)
         {
             cfg.re = config_node.child("Re").first_attribute().as_double();
@@ -233,6 +208,37 @@ namespace nast_hpx { namespace io {
             cfg.tau = 0.5;
         }
 
+        // tau is moved within [min, max] by factor after every window of
+        // steps, towards the most simulated time per wall time
+        cfg.adaptive_tau = false;
+        cfg.tau_min = cfg.tau;
+        cfg.tau_max = cfg.tau;
+        cfg.tau_window = 16;
+        cfg.tau_factor = 1.1;
+
+        if(config_node.child("AdaptiveTau") != NULL)
+        {
+            auto tau_node = config_node.child("AdaptiveTau");
+
+            cfg.adaptive_tau = true;
+            cfg.tau_min = tau_node.attribute("min").as_double(0.1);
+            cfg.tau_max = tau_node.attribute("max").as_double(0.9);
+            cfg.tau_window = tau_node.attribute("window").as_uint(16);
+            cfg.tau_factor = tau_node.attribute("factor").as_double(1.1);
+
+            if (cfg.tau_min <= 0 || cfg.tau_min > cfg.tau_max || cfg.tau_max > 1)
+            {
+                std::cerr << "Error: AdaptiveTau needs 0 < min <= max <= 1!" << std::endl;
+                std::exit(1);
+            }
+
+            if (cfg.tau_window == 0 || cfg.tau_factor <= 1)
+            {
+                std::cerr << "Error: AdaptiveTau needs window >= 1 and factor > 1!" << std::endl;
+                std::exit(1);
+            }
+        }
+
         if(config_node.child("eps") != NULL)
         {
             cfg.eps = config_node.child("eps").first_attribute().as_double();
@@ -274,6 +280,83 @@ namespace nast_hpx { namespace io {
             std::exit(1);
         }
 
+        // the pressure solve starts from P of the step before (0), or from
+        // its linear (1) or quadratic (2) extrapolation in time
+        if(config_node.child("pressureExtrapolation") != NULL)
+        {
+            cfg.pressure_extrapolation =
+                config_node.child("pressureExtrapolation").first_attribute().as_uint();
+
+            if (cfg.pressure_extrapolation > 2)
+            {
+                std::cerr << "Error: pressureExtrapolation must be 0, 1 or 2!" << std::endl;
+                std::exit(1);
+            }
+        }
+        else
+        {
+            cfg.pressure_extrapolation = 0;
+        }
+
+        // Chebyshev acceleration of the Jacobi solver, for the spectral
+        // radius of the Jacobi iteration, estimated at startup by a power
+        // iteration of the given number of sweeps if it is not set
+        cfg.chebyshev = false;
+        cfg.spectral_radius = 0;
+        cfg.spectral_radius_iterations = 50;
+
+        if(config_node.child("Chebyshev") != NULL)
+        {
+            auto chebyshev_node = config_node.child("Chebyshev");
+
+            cfg.chebyshev = true;
+            cfg.spectral_radius = chebyshev_node.attribute("radius").as_double(0);
+            cfg.spectral_radius_iterations = chebyshev_node.attribute("iterations").as_uint(50);
+
+            if (cfg.spectral_radius < 0 || cfg.spectral_radius >= 1)
+            {
+                std::cerr << "Error: Chebyshev radius must be in [0, 1)!" << std::endl;
+                std::exit(1);
+            }
+
+            if (cfg.spectral_radius == 0 && cfg.spectral_radius_iterations < 2)
+            {
+                std::cerr << "Error: Chebyshev needs at least 2 iterations to estimate the radius!"
+                    << std::endl;
+                std::exit(1);
+            }
+        }
+
+        // the residual is only reduced every residualInterval iterations and
+        // after the last one
+        if(config_node.child("residualInterval") != NULL)
+        {
+            cfg.residual_interval =
+                config_node.child("residualInterval").first_attribute().as_uint();
+
+            if (cfg.residual_interval == 0)
+            {
+                std::cerr << "Error: residualInterval must be at least 1!" << std::endl;
+                std::exit(1);
+            }
+        }
+        else
+        {
+            cfg.residual_interval = 1;
+        }
+
+        // direct solve of the pressure with DCTs, only taken if no partition
+        // has an obstacle inside the domain
+        if(config_node.child("fftSolver") != NULL)
+        {
+            cfg.fft_solver =
+                (config_node.child("fftSolver").first_attribute().as_int() == 1);
+        }
+        else
+        {
+            cfg.fft_solver = false;
+        }
+
         if(config_node.child("tEnd") != NULL)
         {
             cfg.t_end = config_node.child("tEnd").first_attribute().as_double();
@@ -293,6 +376,36 @@ namespace nast_hpx { namespace io {
             cfg.max_timesteps = 0;
         }
 
+        if(config_node.child("checkpointInterval") != NULL)
+        {
+            cfg.checkpoint_interval =
+                config_node.child("checkpointInterval").first_attribute().as_uint();
+        }
+        else
+        {
+            cfg.checkpoint_interval = 0;
+        }
+
+        if(config_node.child("checkpointWalltime") != NULL)
+        {
+            cfg.checkpoint_walltime =
+                config_node.child("checkpointWalltime").first_attribute().as_double();
+        }
+        else
+        {
+            cfg.checkpoint_walltime = 0;
+        }
+
+        if(config_node.child("checkpointDir") != NULL)
+        {
+            cfg.checkpoint_dir =
+                config_node.child("checkpointDir").first_attribute().value();
+        }
+        else
+        {
+            cfg.checkpoint_dir = "checkpoint";
+        }
+
         if(config_node.child("dt") != NULL)
         {
             cfg.initial_dt = config_node.child("dt").first_attribute().as_double();
@@ -300,6 +413,32 @@ namespace nast_hpx { namespace io {
         else
             cfg.initial_dt = 0.01;
 
+        if(config_node.child("dtLookahead") != NULL)
+        {
+            cfg.dt_lookahead =
+                (config_node.child("dtLookahead").first_attribute().as_int() == 1);
+        }
+        else
+        {
+            cfg.dt_lookahead = false;
+        }
+
+        if(config_node.child("chainedSteps") != NULL)
+        {
+            cfg.chained_steps =
+                config_node.child("chainedSteps").first_attribute().as_uint();
+        }
+        else
+        {
+            cfg.chained_steps = 16;
+        }
+
+        if (cfg.chained_steps == 0)
+        {
+            std::cerr << "Error: chainedSteps must be at least 1!" << std::endl;
+            std::exit(1);
+        }
+
         if(config_node.child("vtk") != NULL)
         {
             cfg.vtk =
@@ -310,6 +449,131 @@ namespace nast_hpx { namespace io {
             cfg.vtk = false;
         }
 
+        if(config_node.child("vtkFormat") != NULL)
+        {
+            std::string format = config_node.child("vtkFormat").first_attribute().value();
+
+            if (format == "binary")
+                cfg.vtk_binary = true;
+            else if (format == "ascii")
+                cfg.vtk_binary = false;
+            else
+            {
+                std::cerr << "Error: vtkFormat must be binary or ascii!" << std::endl;
+                std::exit(1);
+            }
+        }
+        else
+        {
+            cfg.vtk_binary = true;
+        }
+
+        if(config_node.child("vtkFloat64") != NULL)
+        {
+            cfg.vtk_float64 =
+                (config_node.child("vtkFloat64").first_attribute().as_int() == 1);
+        }
+        else
+        {
+            cfg.vtk_float64 = false;
+        }
+
+        if(config_node.child("vtkCompression") != NULL)
+        {
+            cfg.vtk_compression =
+                config_node.child("vtkCompression").first_attribute().as_int();
+        }
+        else
+        {
+            cfg.vtk_compression = 0;
+        }
+
+        if (cfg.vtk_compression < 0 || cfg.vtk_compression > 9)
+        {
+            std::cerr << "Error: vtkCompression must be a zlib level between 0 and 9!" << std::endl;
+            std::exit(1);
+        }
+
+#ifndef NAST_HPX_WITH_ZLIB
+        if (cfg.vtk_compression > 0)
+        {
+            if (rank == 0)
+                std::cerr << "Warning: built without zlib, vtk output is not compressed!" << std::endl;
+
+            cfg.vtk_compression = 0;
+        }
+#endif
+
+        if(config_node.child("outputMode") != NULL)
+        {
+            std::string mode = config_node.child("outputMode").first_attribute().value();
+
+            cfg.aggregated_output = mode == "aggregated";
+            cfg.compressed_output = mode == "compressed";
+
+            if (mode != "vtk" && !cfg.aggregated_output && !cfg.compressed_output)
+            {
+                std::cerr << "Error: outputMode must be vtk, aggregated or compressed!" << std::endl;
+                std::exit(1);
+            }
+        }
+        else
+        {
+            cfg.aggregated_output = false;
+            cfg.compressed_output = false;
+        }
+
+        // lossless snapshots by default
+        if(config_node.child("snapshotErrorBound") != NULL)
+        {
+            cfg.snapshot_error_bound =
+                config_node.child("snapshotErrorBound").first_attribute().as_double();
+        }
+        else
+        {
+            cfg.snapshot_error_bound = 0;
+        }
+
+        if (cfg.snapshot_error_bound < 0)
+        {
+            std::cerr << "Error: snapshotErrorBound must not be negative!" << std::endl;
+            std::exit(1);
+        }
+
+        // by default one locality in 16 writes
+        if(config_node.child("outputAggregators") != NULL)
+        {
+            cfg.output_aggregators =
+                config_node.child("outputAggregators").first_attribute().as_uint();
+        }
+        else
+        {
+            cfg.output_aggregators = (cfg.num_localities + 15) / 16;
+        }
+
+        cfg.output_aggregators =
+            std::max<std::size_t>(1, std::min(cfg.output_aggregators, cfg.num_localities));
+
+        if(config_node.child("grainSize") != NULL)
+        {
+            cfg.grain_size =
+                config_node.child("grainSize").first_attribute().as_uint();
+        }
+        else
+        {
+            cfg.grain_size = 0;
+        }
+
+        if(config_node.child("staticChunking") != NULL)
+        {
+            cfg.static_chunking =
+                (config_node.child("staticChunking").first_attribute().as_int() == 1);
+        }
+        else
+        {
+            cfg.static_chunking = false;
+        }
+
         if(config_node.child("GX") != NULL)
         {
             cfg.gx = config_node.child("GX").first_attribute().as_double();
@@ -347,6 +611,220 @@ namespace nast_hpx { namespace io {
             cfg.delta_vec = 0;
         }
 
+        std::size_t const max[3] = {cfg.i_max, cfg.j_max, cfg.k_max};
+        double const d[3] = {cfg.dx, cfg.dy, cfg.dz};
+
+        // global index of the first cell starting at or after the lower
+        // and the last cell ending at or before the upper coordinate
+        auto clamp = [&](std::size_t axis, double index)
+        {
+            return static_cast<std::size_t>(
+                std::max(1., std::min(index, static_cast<double>(max[axis]))));
+        };
+        auto lower_cell = [&](std::size_t axis, double coordinate)
+        {
+            return clamp(axis, std::floor(coordinate / d[axis] + 1e-9) + 1);
+        };
+        auto upper_cell = [&](std::size_t axis, double coordinate)
+        {
+            return clamp(axis, std::ceil(coordinate / d[axis] - 1e-9));
+        };
+
+        auto read_axis = [](pugi::xml_node const& node) -> std::size_t
+        {
+            std::string const axis = node.attribute("axis").value();
+
+            if (axis != "x" && axis != "y" && axis != "z")
+            {
+                std::cerr << "Error: " << node.name() << " axis must be x, y or z!" << std::endl;
+                std::exit(1);
+            }
+
+            return axis[0] - 'x';
+        };
+
+        // views are written at their own intervals, independent of vtk
+        if(config_node.child("OutputViews") != NULL)
+        {
+            for (pugi::xml_node node : config_node.child("OutputViews").children())
+            {
+                std::string const type = node.name();
+
+                output_view view;
+                view.name = node.attribute("name").as_string(
+                    (type + std::to_string(cfg.output_views.size())).c_str());
+                view.stride = node.attribute("stride").as_uint(1);
+                view.interval = node.attribute("interval").as_double(cfg.delta_vec);
+
+                for (std::size_t axis = 0; axis < 3; ++axis)
+                {
+                    view.begin[axis] = 1;
+                    view.end[axis] = max[axis];
+                }
+
+                if (type == "Volume")
+                {}
+                else if (type == "Plane")
+                {
+                    std::size_t const axis = read_axis(node);
+
+                    view.begin[axis] = lower_cell(axis, node.attribute("position").as_double());
+                    view.end[axis] = view.begin[axis];
+                }
+                else if (type == "Box")
+                {
+                    char const* lower[3] = {"x0", "y0", "z0"};
+                    char const* upper[3] = {"x1", "y1", "z1"};
+
+                    for (std::size_t axis = 0; axis < 3; ++axis)
+                    {
+                        view.begin[axis] = lower_cell(axis, node.attribute(lower[axis]).as_double());
+                        view.end[axis] = std::max(view.begin[axis],
+                            upper_cell(axis, node.attribute(upper[axis]).as_double()));
+                    }
+                }
+                else
+                {
+                    std::cerr << "Error: unknown view " << type << " in OutputViews!" << std::endl;
+                    std::exit(1);
+                }
+
+                if (view.stride == 0 || view.interval <= 0)
+                {
+                    std::cerr << "Error: view " << view.name
+                        << " needs a positive stride and interval!" << std::endl;
+                    std::exit(1);
+                }
+
+                for (auto const& other : cfg.output_views)
+                    if (other.name == view.name)
+                    {
+                        std::cerr << "Error: view " << view.name << " defined twice!" << std::endl;
+                        std::exit(1);
+                    }
+
+                cfg.output_views.push_back(view);
+            }
+        }
+
+        // probes and integrated quantities, evaluated every monitorInterval
+        // steps and appended to the monitor file by the root
+        cfg.monitor_file = "monitors.csv";
+        cfg.monitor_interval = 1;
+
+        if(config_node.child("Monitors") != NULL)
+        {
+            auto monitors_node = config_node.child("Monitors");
+
+            cfg.monitor_file = monitors_node.attribute("file").as_string("monitors.csv");
+            cfg.monitor_interval = monitors_node.attribute("interval").as_uint(1);
+
+            if (cfg.monitor_interval == 0)
+            {
+                std::cerr << "Error: Monitors interval must be at least 1!" << std::endl;
+                std::exit(1);
+            }
+
+            for (pugi::xml_node node : monitors_node.children())
+            {
+                std::string const type = node.name();
+
+                monitor m;
+                m.name = node.attribute("name").as_string(
+                    (type + std::to_string(cfg.monitors.size())).c_str());
+                m.axis = 0;
+                m.cell[0] = m.cell[1] = m.cell[2] = 1;
+                m.second = 1;
+
+                if (type == "Probe")
+                {
+                    m.type = monitor::probe;
+                    m.cell[0] = lower_cell(0, node.attribute("x").as_double());
+                    m.cell[1] = lower_cell(1, node.attribute("y").as_double());
+                    m.cell[2] = lower_cell(2, node.attribute("z").as_double());
+                }
+                else if (type == "PlaneAverage")
+                {
+                    m.type = monitor::plane_average;
+                    m.axis = read_axis(node);
+                    m.cell[m.axis] = lower_cell(m.axis, node.attribute("position").as_double());
+                }
+                else if (type == "KineticEnergy")
+                    m.type = monitor::kinetic_energy;
+                else if (type == "PressureDrop")
+                {
+                    m.type = monitor::pressure_drop;
+                    m.axis = read_axis(node);
+                    m.cell[m.axis] = lower_cell(m.axis, node.attribute("from").as_double());
+                    m.second = lower_cell(m.axis, node.attribute("to").as_double());
+                }
+                else
+                {
+                    std::cerr << "Error: unknown monitor " << type << " in Monitors!" << std::endl;
+                    std::exit(1);
+                }
+
+                cfg.monitors.push_back(m);
+            }
+        }
+
+        // per step solver records, written by the root in batches of
+        // telemetryBuffer records, disabled without a file
+        cfg.telemetry_file = "";
+        cfg.telemetry_buffer = 64;
+
+        if(config_node.child("Telemetry") != NULL)
+        {
+            auto telemetry_node = config_node.child("Telemetry");
+
+            cfg.telemetry_file = telemetry_node.attribute("file").as_string("telemetry.jsonl");
+            cfg.telemetry_buffer = telemetry_node.attribute("buffer").as_uint(64);
+
+            if (cfg.telemetry_buffer == 0)
+            {
+                std::cerr << "Error: Telemetry buffer must hold at least 1 record!" << std::endl;
+                std::exit(1);
+            }
+        }
+
+        // tasks of every locality as Chrome trace, at most events per worker
+        // thread are kept, disabled without a file prefix
+        cfg.trace_file = "";
+        cfg.trace_events = 1 << 18;
+
+        if(config_node.child("Trace") != NULL)
+        {
+            auto trace_node = config_node.child("Trace");
+
+            cfg.trace_file = trace_node.attribute("file").as_string("trace");
+            cfg.trace_events = trace_node.attribute("events").as_uint(1 << 18);
+        }
+
+        // perf counters around the stencils, reported per phase at the end
+        // of a run, the kernels are classified against the machine balance
+        // in flops per byte if it is given
+        cfg.hw_counters = false;
+        cfg.machine_balance = 0;
+
+        if(config_node.child("HardwareCounters") != NULL)
+        {
+            cfg.hw_counters = true;
+            cfg.machine_balance =
+                config_node.child("HardwareCounters").attribute("balance").as_double(0);
+        }
+
+        // the halo statistics are always counted, this prints them per
+        // locality at the end of a run
+        if(config_node.child("haloSummary") != NULL)
+        {
+            cfg.halo_summary =
+                (config_node.child("haloSummary").first_attribute().as_int() == 1);
+        }
+        else
+        {
+            cfg.halo_summary = false;
+        }
+
         if(config_node.child("BoundaryConditions") != NULL)
         {
             auto bc_node = config_node.child("BoundaryConditions");
@@ -3,9 +3,12 @@
 
 #include "util/defines.hpp"
 #include "grid/boundary_data.hpp"
+#include "monitor.hpp"
+#include "output_view.hpp"
 
 #include <iostream>
 #include <bitset>
+#include <string>
 #include <vector>
 
 namespace nast_hpx { namespace io {
@@ -18,6 +21,7 @@ struct config
         uint j_max;
         uint k_max;
         uint num_fluid_cells;
+        uint num_local_fluid_cells;
 
         double x_length;
         double y_length;
@@ -43,6 +47,11 @@ struct config
         double pr;
         double omega;
         double tau;
+        bool adaptive_tau;
+        double tau_min;
+        double tau_max;
+        std::size_t tau_window;
+        double tau_factor;
         double alpha;
         double beta;
         double gx;
@@ -50,14 +59,45 @@ struct config
         double gz;
 
         bool vtk;
+        bool vtk_binary;
+        bool vtk_float64;
+        int vtk_compression;
+        bool aggregated_output;
+        std::size_t output_aggregators;
+        bool compressed_output;
+        double snapshot_error_bound;
+        std::vector<output_view> output_views;
+        std::vector<monitor> monitors;
+        std::string monitor_file;
+        std::size_t monitor_interval;
+        std::string telemetry_file;
+        std::size_t telemetry_buffer;
+        std::string trace_file;
+        std::size_t trace_events;
+        bool hw_counters;
+        double machine_balance;
+        bool halo_summary;
         double delta_vec;
         bool verbose;
 
         double t_end;
         double initial_dt;
+        bool dt_lookahead;
+        std::size_t chained_steps;
         std::size_t max_timesteps;
 
+        std::size_t checkpoint_interval;
+        double checkpoint_walltime;
+        std::string checkpoint_dir;
+        std::string restart_file;
+
         uint iter_max;
+        uint pressure_extrapolation;
+        bool chebyshev;
+        double spectral_radius;
+        std::size_t spectral_radius_iterations;
+        std::size_t residual_interval;
+        bool fft_solver;
         double eps;
         double eps_sq;
 
@@ -76,6 +116,8 @@ struct config
         std::size_t idz;
 
         std::size_t threads;
+        std::size_t grain_size;
+        bool static_chunking;
 
         grid::boundary_condition bnd_condition;
 
@@ -87,14 +129,16 @@ struct config
         template <typename Archive>
         void serialize(Archive& ar, const unsigned int version)
         {
-            ar & i_max & j_max & k_max & num_fluid_cells & x_length
+            ar & i_max & j_max & k_max & num_fluid_cells & num_local_fluid_cells & x_length
                 & y_length & z_length & dx & dy & dz & over_dx & over_dy & over_dz
-                & dx_sq & dy_sq & dz_sq & part1 & part2 & factor_jacobi & re & pr & omega & tau & alpha
-                & beta & gx & gy & gz & vtk & delta_vec & verbose & t_end & initial_dt & max_timesteps
-                & iter_max & eps & eps_sq & num_localities
+                & dx_sq & dy_sq & dz_sq & part1 & part2 & factor_jacobi & re & pr & omega & tau & adaptive_tau & tau_min & tau_max & tau_window & tau_factor & alpha
+                & beta & gx & gy & gz & vtk & vtk_binary & vtk_float64 & vtk_compression & aggregated_output & output_aggregators & compressed_output & snapshot_error_bound & output_views & monitors & monitor_file & monitor_interval & telemetry_file & telemetry_buffer & trace_file & trace_events & hw_counters & machine_balance & halo_summary & delta_vec & verbose & t_end & initial_dt & dt_lookahead & chained_steps & max_timesteps
+                & checkpoint_interval & checkpoint_walltime & checkpoint_dir & restart_file
+                & iter_max & pressure_extrapolation & chebyshev & spectral_radius & spectral_radius_iterations & residual_interval & fft_solver & eps & eps_sq & num_localities
                 & num_localities_x & num_localities_y & num_localities_z
                 & cells_x_per_partition & cells_y_per_partition & cells_z_per_partition
-                & rank & idx & idy & idz & threads & with_initial_uv_grid
+                & rank & idx & idy & idz & threads & grain_size & static_chunking
+                & with_initial_uv_grid
                 & bnd_condition;
         }
 
@@ -130,6 +174,7 @@ struct config
                 << "\n\tidy = " << config.idy
                 << "\n\tidy = " << config.idz
                 << "\n\tnumFluid = " << config.num_fluid_cells
+                << "\n\tnumLocalFluid = " << config.num_local_fluid_cells
                 << "\n\txLength = " << config.x_length
                 << "\n\tyLength = " << config.y_length
                 << "\n\tyLength = " << config.z_length
@@ -142,11 +187,22 @@ struct config
                 << "\n\tgz = " << config.gz
                 << "\n\tbeta = " << config.beta
                 << "\n\tdt = " << config.initial_dt
+                << "\n\tdt_lookahead = " << config.dt_lookahead
+                << "\n\tchained_steps = " << config.chained_steps
                 << "\n\tt_end = " << config.t_end
                 << "\n\tmax_timesteps = " << config.max_timesteps
+                << "\n\tcheckpoint_interval = " << config.checkpoint_interval
+                << "\n\tcheckpoint_walltime = " << config.checkpoint_walltime
+                << "\n\tcheckpoint_dir = " << config.checkpoint_dir
+                << "\n\trestart_file = " << config.restart_file
                 << "\n\tboundary = " << config.bnd_condition
                 << "\nSIMULATION:"
                 << "\n\ttau = " << config.tau
+                << "\n\tadaptive_tau = " << config.adaptive_tau
+                << "\n\ttau_min = " << config.tau_min
+                << "\n\ttau_max = " << config.tau_max
+                << "\n\ttau_window = " << config.tau_window
+                << "\n\ttau_factor = " << config.tau_factor
                 << "\n\teps = " << config.eps
                 << "\n\teps_sq = " << config.eps_sq
                 << "\n\talpha = " << config.alpha
@@ -156,12 +212,38 @@ struct config
                 << "\n\tfactor_jacobi = " << config.factor_jacobi
                 << "\n\tdelta_vec = " << config.delta_vec
                 << "\n\titer_max = " << config.iter_max
+                << "\n\tpressure_extrapolation = " << config.pressure_extrapolation
+                << "\n\tchebyshev = " << config.chebyshev
+                << "\n\tspectral_radius = " << config.spectral_radius
+                << "\n\tspectral_radius_iterations = " << config.spectral_radius_iterations
+                << "\n\tresidual_interval = " << config.residual_interval
+                << "\n\tfft_solver = " << config.fft_solver
                 << "\n\tvtk = " << config.vtk
+                << "\n\tvtk_binary = " << config.vtk_binary
+                << "\n\tvtk_float64 = " << config.vtk_float64
+                << "\n\tvtk_compression = " << config.vtk_compression
+                << "\n\taggregated_output = " << config.aggregated_output
+                << "\n\toutput_aggregators = " << config.output_aggregators
+                << "\n\tcompressed_output = " << config.compressed_output
+                << "\n\tsnapshot_error_bound = " << config.snapshot_error_bound
+                << "\n\toutput_views = " << config.output_views.size()
+                << "\n\tmonitors = " << config.monitors.size()
+                << "\n\tmonitor_file = " << config.monitor_file
+                << "\n\tmonitor_interval = " << config.monitor_interval
+                << "\n\ttelemetry_file = " << config.telemetry_file
+                << "\n\ttelemetry_buffer = " << config.telemetry_buffer
+                << "\n\ttrace_file = " << config.trace_file
+                << "\n\ttrace_events = " << config.trace_events
+                << "\n\thw_counters = " << config.hw_counters
+                << "\n\tmachine_balance = " << config.machine_balance
+                << "\n\thalo_summary = " << config.halo_summary
+                << "\n\tgrain_size = " << config.grain_size
+                << "\n\tstatic_chunking = " << config.static_chunking
                 << "\n}";
             return os;
         }
 
-        static config read_config_from_file(const char *xml_path, const char *grid_path, std::size_t rank, std::size_t num_localities);
+        static config read_config_from_file(const char *xml_path, const char *grid_path, const char *restart_dir, std::size_t rank, std::size_t num_localities);
 
 };
 
@@ -0,0 +1,369 @@
+#include "geometry.hpp"
+
+#include "pugixml/pugixml.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+#include <thread>
+
+namespace nast_hpx { namespace io {
+
+namespace {
+
+    double component(triple<double> const& t, std::size_t axis)
+    {
+        return axis == 0 ? t.x : (axis == 1 ? t.y : t.z);
+    }
+
+    /// calls f(k, thread) for every k in [begin, end) on up to one thread per core
+    template <typename F>
+    void for_each_plane(std::size_t begin, std::size_t end, F const& f)
+    {
+        std::size_t const num_threads =
+            std::max<std::size_t>(1, std::min<std::size_t>(std::thread::hardware_concurrency(),
+                                                           end - begin));
+
+        auto planes = [&](std::size_t thread)
+        {
+            for (std::size_t k = begin + thread; k < end; k += num_threads)
+                f(k, thread);
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(num_threads - 1);
+
+        for (std::size_t thread = 1; thread < num_threads; ++thread)
+            threads.emplace_back(planes, thread);
+
+        planes(0);
+
+        for (auto& thread : threads)
+            thread.join();
+    }
+}
+
+bool shape::contains(double x, double y, double z) const
+{
+    switch (type)
+    {
+        case box:
+            return x >= min.x && x <= max.x && y >= min.y && y <= max.y
+                && z >= min.z && z <= max.z;
+
+        case sphere:
+            return (x - min.x) * (x - min.x) + (y - min.y) * (y - min.y)
+                + (z - min.z) * (z - min.z) <= radius * radius;
+
+        case cylinder:
+        {
+            triple<double> const p(x, y, z);
+            double const along = component(p, axis);
+
+            if (along < component(min, axis) || along > component(max, axis))
+                return false;
+
+            double dist_sq = 0;
+            for (std::size_t d = 0; d < 3; ++d)
+            {
+                if (d == axis)
+                    continue;
+
+                double const diff = component(p, d) - component(min, d);
+                dist_sq += diff * diff;
+            }
+
+            return dist_sq <= radius * radius;
+        }
+    }
+
+    return false;
+}
+
+bool shape::intersects(triple<double> const& lower, triple<double> const& upper) const
+{
+    for (std::size_t d = 0; d < 3; ++d)
+    {
+        double low, high;
+
+        if (type == box)
+        {
+            low = component(min, d);
+            high = component(max, d);
+        }
+        else if (type == cylinder && d == axis)
+        {
+            low = component(min, d);
+            high = component(max, d);
+        }
+        else
+        {
+            low = component(min, d) - radius;
+            high = component(min, d) + radius;
+        }
+
+        if (high < component(lower, d) || low > component(upper, d))
+            return false;
+    }
+
+    return true;
+}
+
+geometry geometry::read(pugi::xml_node const& geometry_node)
+{
+    geometry geo;
+
+    pugi::xml_node domain = geometry_node.child("Domain");
+
+    if (domain == NULL)
+    {
+        std::cerr << "Error: Geometry needs a Domain!" << std::endl;
+        std::exit(1);
+    }
+
+    geo.i_max = domain.attribute("iMax").as_uint();
+    geo.j_max = domain.attribute("jMax").as_uint();
+    geo.k_max = domain.attribute("kMax").as_uint();
+
+    geo.x_length = domain.attribute("xLength").as_double(1.);
+    geo.y_length = domain.attribute("yLength").as_double(1.);
+    geo.z_length = domain.attribute("zLength").as_double(1.);
+
+    if (geo.i_max == 0 || geo.j_max == 0 || geo.k_max == 0)
+    {
+        std::cerr << "Error: Domain needs iMax, jMax and kMax!" << std::endl;
+        std::exit(1);
+    }
+
+    double const inf = std::numeric_limits<double>::max();
+
+    for (pugi::xml_node node : geometry_node.children())
+    {
+        std::string const name = node.name();
+
+        if (name == "Domain")
+            continue;
+
+        shape s;
+        s.radius = 0;
+        s.axis = 0;
+
+        if (name == "Box")
+        {
+            s.type = shape::box;
+            s.min = triple<double>(node.attribute("x0").as_double(),
+                                   node.attribute("y0").as_double(),
+                                   node.attribute("z0").as_double());
+            s.max = triple<double>(node.attribute("x1").as_double(),
+                                   node.attribute("y1").as_double(),
+                                   node.attribute("z1").as_double());
+
+            geo.obstacles.push_back(s);
+        }
+        else if (name == "Sphere")
+        {
+            s.type = shape::sphere;
+            s.min = triple<double>(node.attribute("x").as_double(),
+                                   node.attribute("y").as_double(),
+                                   node.attribute("z").as_double());
+            s.max = s.min;
+            s.radius = node.attribute("r").as_double();
+
+            geo.obstacles.push_back(s);
+        }
+        else if (name == "Cylinder")
+        {
+            std::string const axis = node.attribute("axis").value();
+
+            if (axis != "x" && axis != "y" && axis != "z")
+            {
+                std::cerr << "Error: Cylinder axis must be x, y or z!" << std::endl;
+                std::exit(1);
+            }
+
+            s.type = shape::cylinder;
+            s.axis = axis[0] - 'x';
+            s.radius = node.attribute("r").as_double();
+            s.min = triple<double>(node.attribute("x").as_double(),
+                                   node.attribute("y").as_double(),
+                                   node.attribute("z").as_double());
+            s.max = s.min;
+
+            double const lower = node.attribute("min").as_double(-inf);
+            double const upper = node.attribute("max").as_double(inf);
+
+            (s.axis == 0 ? s.min.x : (s.axis == 1 ? s.min.y : s.min.z)) = lower;
+            (s.axis == 0 ? s.max.x : (s.axis == 1 ? s.max.y : s.max.z)) = upper;
+
+            geo.obstacles.push_back(s);
+        }
+        else if (name == "RandomSpheres")
+        {
+            std::size_t const count = node.attribute("count").as_uint();
+            double const r_min = node.attribute("rMin").as_double();
+            double const r_max = node.attribute("rMax").as_double(r_min);
+
+            triple<double> const lower(node.attribute("x0").as_double(0.),
+                                       node.attribute("y0").as_double(0.),
+                                       node.attribute("z0").as_double(0.));
+            triple<double> const upper(node.attribute("x1").as_double(geo.x_length),
+                                       node.attribute("y1").as_double(geo.y_length),
+                                       node.attribute("z1").as_double(geo.z_length));
+
+            // draw from the raw generator output, the standard distributions
+            // are not guaranteed to give the same numbers everywhere
+            std::mt19937_64 gen(node.attribute("seed").as_ullong(0));
+            auto uniform = [&gen](double low, double high)
+            {
+                return low + (high - low) * ((gen() >> 11) * (1. / 9007199254740992.));
+            };
+
+            s.type = shape::sphere;
+
+            for (std::size_t n = 0; n < count; ++n)
+            {
+                s.min.x = uniform(lower.x, upper.x);
+                s.min.y = uniform(lower.y, upper.y);
+                s.min.z = uniform(lower.z, upper.z);
+                s.max = s.min;
+                s.radius = uniform(r_min, r_max);
+
+                geo.obstacles.push_back(s);
+            }
+        }
+        else
+        {
+            std::cerr << "Error: unknown shape " << name << " in Geometry!" << std::endl;
+            std::exit(1);
+        }
+    }
+
+    return geo;
+}
+
+std::size_t geometry::rasterize(config& cfg, std::size_t idx, std::size_t idy, std::size_t idz) const
+{
+    std::size_t const flag_res_x = cfg.cells_x_per_partition + 2;
+    std::size_t const flag_res_y = cfg.cells_y_per_partition + 2;
+    std::size_t const flag_res_z = cfg.cells_z_per_partition + 2;
+
+    // global index of the first halo cell of the partition
+    std::int64_t const offset_i = static_cast<std::int64_t>(idx * cfg.cells_x_per_partition) - 1;
+    std::int64_t const offset_j = static_cast<std::int64_t>(idy * cfg.cells_y_per_partition) - 1;
+    std::int64_t const offset_k = static_cast<std::int64_t>(idz * cfg.cells_z_per_partition) - 1;
+
+    double const dx = x_length / i_max;
+    double const dy = y_length / j_max;
+    double const dz = z_length / k_max;
+
+    // only shapes reaching into the partition and its halo are tested
+    triple<double> const lower((offset_i - 1) * dx, (offset_j - 1) * dy, (offset_k - 1) * dz);
+    triple<double> const upper((offset_i + flag_res_x) * dx, (offset_j + flag_res_y) * dy,
+        (offset_k + flag_res_z) * dz);
+
+    std::vector<shape const*> local_obstacles;
+    for (auto const& s : obstacles)
+        if (s.intersects(lower, upper))
+            local_obstacles.push_back(&s);
+
+    std::vector<char> fluid(flag_res_x * flag_res_y * flag_res_z, 0);
+
+    for_each_plane(0, flag_res_z,
+        [&](std::size_t k, std::size_t)
+        {
+            std::int64_t const gk = offset_k + k;
+
+            for (std::size_t j = 0; j < flag_res_y; ++j)
+            {
+                std::int64_t const gj = offset_j + j;
+
+                for (std::size_t i = 0; i < flag_res_x; ++i)
+                {
+                    std::int64_t const gi = offset_i + i;
+
+                    if (gi < 1 || gi > i_max || gj < 1 || gj > j_max || gk < 1 || gk > k_max)
+                        continue;
+
+                    double const x = (gi - 0.5) * dx;
+                    double const y = (gj - 0.5) * dy;
+                    double const z = (gk - 0.5) * dz;
+
+                    bool is_obstacle_cell = false;
+                    for (shape const* s : local_obstacles)
+                    {
+                        if (s->contains(x, y, z))
+                        {
+                            is_obstacle_cell = true;
+                            break;
+                        }
+                    }
+
+                    fluid[k * flag_res_x * flag_res_y + j * flag_res_x + i] = !is_obstacle_cell;
+                }
+            }
+        }
+    );
+
+    cfg.flag_grid.clear();
+    cfg.flag_grid.resize(flag_res_x * flag_res_y * flag_res_z);
+
+    std::size_t const num_threads =
+        std::max<std::size_t>(1, std::min<std::size_t>(std::thread::hardware_concurrency(),
+                                                       flag_res_z - 2));
+    std::vector<std::size_t> fluid_cells(num_threads, 0);
+
+    for_each_plane(1, flag_res_z - 1,
+        [&](std::size_t k, std::size_t thread)
+        {
+            for (std::size_t j = 1; j < flag_res_y - 1; ++j)
+            {
+                for (std::size_t i = 1; i < flag_res_x - 1; ++i)
+                {
+                    std::size_t const id = k * flag_res_x * flag_res_y + j * flag_res_x + i;
+
+                    std::int64_t const gi = offset_i + i;
+                    std::int64_t const gj = offset_j + j;
+                    std::int64_t const gk = offset_k + k;
+
+                    std::bitset<9> flag;
+
+                    if (fluid[id])
+                    {
+                        flag.set(is_fluid);
+                        ++fluid_cells[thread];
+                    }
+                    else if (gi == 0 || gi == i_max + 1 || gj == 0 || gj == j_max + 1
+                            || gk == 0 || gk == k_max + 1)
+                    {
+                        flag.set(is_boundary);
+                        flag.set(is_obstacle);
+                    }
+                    else
+                        flag.set(is_obstacle);
+
+                    flag.set(has_fluid_left, fluid[id - 1] != 0);
+                    flag.set(has_fluid_right, fluid[id + 1] != 0);
+                    flag.set(has_fluid_front, fluid[id - flag_res_x] != 0);
+                    flag.set(has_fluid_back, fluid[id + flag_res_x] != 0);
+                    flag.set(has_fluid_bottom, fluid[id - flag_res_x * flag_res_y] != 0);
+                    flag.set(has_fluid_top, fluid[id + flag_res_x * flag_res_y] != 0);
+
+                    cfg.flag_grid[id] = flag;
+                }
+            }
+        }
+    );
+
+    std::size_t num_fluid_cells = 0;
+    for (std::size_t count : fluid_cells)
+        num_fluid_cells += count;
+
+    return num_fluid_cells;
+}
+
+}
+}
@@ -0,0 +1,78 @@
+#ifndef NAST_HPX_IO_GEOMETRY_HPP_
+#define NAST_HPX_IO_GEOMETRY_HPP_
+
+#include "config.hpp"
+
+#include "util/triple.hpp"
+
+#include <vector>
+
+namespace pugi {
+    class xml_node;
+}
+
+namespace nast_hpx { namespace io {
+
+/// Analytic obstacle, in domain coordinates.
+struct shape
+{
+    enum shape_type {
+        box = 0,
+        sphere,
+        cylinder
+    };
+
+    shape_type type;
+
+    /// box: lower corner, sphere and cylinder: center
+    triple<double> min;
+    /// box: upper corner, cylinder: extent along its axis in min.axis, max.axis
+    triple<double> max;
+
+    double radius;
+    std::size_t axis;
+
+    bool contains(double x, double y, double z) const;
+
+    /// true if the bounding box of the shape overlaps [lower, upper]
+    bool intersects(triple<double> const& lower, triple<double> const& upper) const;
+};
+
+/// Domain and obstacles described in the Geometry section of the
+/// configuration, used instead of a grid file.
+///
+///  <Geometry>
+///      <Domain iMax="64" jMax="64" kMax="64" xLength="1" yLength="1" zLength="1"/>
+///      <Box x0="0" y0="0" z0="0" x1="0.25" y1="1" z1="0.5"/>
+///      <Sphere x="0.5" y="0.5" z="0.5" r="0.1"/>
+///      <Cylinder axis="z" x="0.5" y="0.5" r="0.1" min="0" max="1"/>
+///      <RandomSpheres count="100" rMin="0.02" rMax="0.05" seed="42"/>
+///  </Geometry>
+///
+/// Random packs are expanded with a fixed generator from their seed, so every
+/// locality places the same spheres. A cell is an obstacle if its center lies
+/// in any shape, the outer layer of cells is always boundary. Flags follow
+/// tools/3D/grid_3d.py.
+struct geometry
+{
+    uint i_max;
+    uint j_max;
+    uint k_max;
+
+    double x_length;
+    double y_length;
+    double z_length;
+
+    std::vector<shape> obstacles;
+
+    static geometry read(pugi::xml_node const& geometry_node);
+
+    /// Fills cfg.flag_grid with the partition (idx, idy, idz) and returns the
+    /// number of fluid cells in it.
+    std::size_t rasterize(config& cfg, std::size_t idx, std::size_t idy, std::size_t idz) const;
+};
+
+}
+}
+
+#endif
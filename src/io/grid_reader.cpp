@@ -0,0 +1,493 @@
+#include "grid_reader.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace nast_hpx { namespace io {
+
+namespace {
+
+    char const index_magic[8] = {'N', 'A', 'S', 'T', 'I', 'D', 'X', '1'};
+
+    std::uint64_t size_of(std::ifstream& file)
+    {
+        file.seekg(0, std::ios::end);
+        std::uint64_t size = file.tellg();
+        file.seekg(0, std::ios::beg);
+
+        return size;
+    }
+
+    bool read_index(std::string const& index_path, std::uint64_t grid_size,
+        std::size_t num_offsets, std::vector<std::uint64_t>& offsets)
+    {
+        std::ifstream file(index_path, std::ios::binary);
+
+        if (!file)
+            return false;
+
+        char magic[8];
+        std::uint64_t size, count;
+
+        file.read(magic, sizeof(magic));
+        file.read(reinterpret_cast<char*>(&size), sizeof(size));
+        file.read(reinterpret_cast<char*>(&count), sizeof(count));
+
+        if (!file || std::memcmp(magic, index_magic, sizeof(magic)) != 0
+                || size != grid_size || count != num_offsets)
+            return false;
+
+        offsets.resize(count);
+        file.read(reinterpret_cast<char*>(offsets.data()), count * sizeof(std::uint64_t));
+
+        return static_cast<bool>(file);
+    }
+
+    void write_index(std::string const& index_path, std::uint64_t grid_size,
+        std::vector<std::uint64_t> const& offsets)
+    {
+        // other localities may look for the index at the same time, so it
+        // only appears under its final name once it is complete
+        std::string const tmp_path = index_path + ".tmp";
+
+        {
+            std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+
+            if (!file)
+                return;
+
+            std::uint64_t const count = offsets.size();
+
+            file.write(index_magic, sizeof(index_magic));
+            file.write(reinterpret_cast<char const*>(&grid_size), sizeof(grid_size));
+            file.write(reinterpret_cast<char const*>(&count), sizeof(count));
+            file.write(reinterpret_cast<char const*>(offsets.data()), count * sizeof(std::uint64_t));
+
+            if (!file)
+            {
+                file.close();
+                std::remove(tmp_path.c_str());
+                return;
+            }
+        }
+
+        std::rename(tmp_path.c_str(), index_path.c_str());
+    }
+
+    /// Read-only mapping of a whole file, unmapped on destruction.
+    struct mapped_file
+    {
+        mapped_file() : data(NULL), size(0) {}
+
+        ~mapped_file()
+        {
+            if (data != NULL)
+                munmap(const_cast<char*>(data), size);
+        }
+
+        void map(const char* path)
+        {
+            int fd = open(path, O_RDONLY);
+
+            struct stat st;
+            if (fd < 0 || fstat(fd, &st) != 0)
+            {
+                std::cerr << "Could not open grid file at " << path << "!" << std::endl;
+                std::exit(1);
+            }
+
+            size = st.st_size;
+
+            void* addr = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            close(fd);
+
+            if (addr == MAP_FAILED)
+            {
+                std::cerr << "Error: could not map grid file " << path << "!" << std::endl;
+                std::exit(1);
+            }
+
+            data = static_cast<char const*>(addr);
+        }
+
+        char const* data;
+        std::size_t size;
+    };
+}
+
+grid_header grid_reader::read_header(const char* grid_path)
+{
+    std::ifstream file(grid_path, std::ios::binary);
+
+    if (!file)
+    {
+        std::cerr << "Could not open grid file at " << grid_path << "!" << std::endl;
+        std::exit(1);
+    }
+
+    grid_header header;
+
+    binary_grid_header binary_header;
+    file.read(reinterpret_cast<char*>(&binary_header), sizeof(binary_header));
+
+    if (file && std::memcmp(binary_header.magic, binary_grid_magic, sizeof(binary_grid_magic)) == 0)
+    {
+        header.i_max = binary_header.i_max;
+        header.j_max = binary_header.j_max;
+        header.k_max = binary_header.k_max;
+
+        header.x_length = binary_header.x_length;
+        header.y_length = binary_header.y_length;
+        header.z_length = binary_header.z_length;
+
+        header.data_offset = sizeof(binary_grid_header);
+        header.binary = true;
+        header.run_length = (binary_header.run_length != 0);
+
+        return header;
+    }
+
+    file.clear();
+    file.seekg(0, std::ios::beg);
+
+    header.binary = false;
+    header.run_length = false;
+
+    std::string cfg_line;
+
+    std::getline(file, cfg_line);
+    header.i_max = std::stoi(cfg_line);
+
+    std::getline(file, cfg_line);
+    header.j_max = std::stoi(cfg_line);
+
+    std::getline(file, cfg_line);
+    header.k_max = std::stoi(cfg_line);
+
+    std::getline(file, cfg_line);
+    header.x_length = std::stod(cfg_line);
+
+    std::getline(file, cfg_line);
+    header.y_length = std::stod(cfg_line);
+
+    std::getline(file, cfg_line);
+    header.z_length = std::stod(cfg_line);
+
+    if (!file)
+    {
+        std::cerr << "Error: incomplete header in grid file " << grid_path << "!" << std::endl;
+        std::exit(1);
+    }
+
+    header.data_offset = file.tellg();
+
+    return header;
+}
+
+std::vector<std::uint64_t> grid_reader::plane_offsets(const char* grid_path,
+    grid_header const& header, bool write_index_file)
+{
+    std::ifstream file(grid_path, std::ios::binary);
+    std::uint64_t const grid_size = size_of(file);
+
+    // offset of every plane plus the end of the last one
+    std::size_t const num_offsets = header.k_max + 3;
+    std::string const index_path = std::string(grid_path) + ".idx";
+
+    std::vector<std::uint64_t> offsets;
+
+    if (read_index(index_path, grid_size, num_offsets, offsets))
+        return offsets;
+
+    // no usable index, find the planes by counting line breaks, which is
+    // still much cheaper than parsing every flag
+    offsets.clear();
+    offsets.reserve(num_offsets);
+    offsets.push_back(header.data_offset);
+
+    std::size_t const lines_per_plane = header.j_max + 2;
+    std::size_t lines = 0;
+
+    std::vector<char> buffer(1 << 22);
+    std::uint64_t pos = header.data_offset;
+
+    file.seekg(header.data_offset);
+
+    while (offsets.size() < num_offsets)
+    {
+        file.read(buffer.data(), buffer.size());
+        std::streamsize const read = file.gcount();
+
+        if (read <= 0)
+            break;
+
+        char const* begin = buffer.data();
+        char const* end = begin + read;
+
+        for (char const* it = begin;
+                (it = static_cast<char const*>(std::memchr(it, '\n', end - it))) != NULL; )
+        {
+            ++it;
+
+            if (++lines % lines_per_plane == 0)
+            {
+                offsets.push_back(pos + (it - begin));
+
+                if (offsets.size() == num_offsets)
+                    break;
+            }
+        }
+
+        pos += read;
+    }
+
+    // last line without a trailing line break
+    if (offsets.size() == num_offsets - 1 && lines % lines_per_plane == lines_per_plane - 1)
+        offsets.push_back(grid_size);
+
+    if (offsets.size() != num_offsets)
+    {
+        std::cerr << "Error: grid file " << grid_path << " holds fewer than "
+            << header.k_max + 2 << " planes!" << std::endl;
+        std::exit(1);
+    }
+
+    if (write_index_file)
+        write_index(index_path, grid_size, offsets);
+
+    return offsets;
+}
+
+std::size_t grid_reader::read_partition(const char* grid_path, grid_header const& header,
+    config& cfg, std::size_t idx, std::size_t idy, std::size_t idz, bool write_index_file)
+{
+    std::size_t const flag_res_x = cfg.cells_x_per_partition + 2;
+    std::size_t const flag_res_y = cfg.cells_y_per_partition + 2;
+    std::size_t const flag_res_z = cfg.cells_z_per_partition + 2;
+
+    cfg.flag_grid.clear();
+    cfg.flag_grid.resize(flag_res_x * flag_res_y * flag_res_z);
+
+    std::size_t const start_i = idx * cfg.cells_x_per_partition;
+    std::size_t const end_i = start_i + cfg.cells_x_per_partition;
+
+    std::size_t const start_j = idy * cfg.cells_y_per_partition;
+    std::size_t const end_j = start_j + cfg.cells_y_per_partition;
+
+    std::size_t const start_k = idz * cfg.cells_z_per_partition;
+    std::size_t const end_k = start_k + cfg.cells_z_per_partition;
+
+    std::size_t const num_threads =
+        std::max<std::size_t>(1, std::min<std::size_t>(std::thread::hardware_concurrency(),
+                                                       end_k - start_k));
+
+    std::vector<std::size_t> fluid_cells(num_threads, 0);
+    std::atomic<bool> failed(false);
+
+    auto store = [&](unsigned long value, std::size_t i, std::size_t j, std::size_t k,
+        std::size_t thread)
+    {
+        std::bitset<9> flag(value);
+
+        if (flag.test(is_fluid))
+            ++fluid_cells[thread];
+
+        cfg.flag_grid[(k - start_k + 1) * flag_res_x * flag_res_y
+                        + (j - start_j + 1) * flag_res_x
+                        + i - start_i + 1] = flag;
+    };
+
+    std::function<void(std::size_t)> parse_planes;
+    std::size_t const row_size = header.i_max + 2;
+
+    mapped_file mapped;
+    std::vector<std::uint64_t> offsets;
+
+    if (header.binary)
+    {
+        mapped.map(grid_path);
+
+        std::size_t const num_offsets = header.k_max + 3;
+
+        if (mapped.size < header.data_offset + num_offsets * sizeof(std::uint64_t))
+        {
+            std::cerr << "Error: grid file " << grid_path << " is truncated!" << std::endl;
+            std::exit(1);
+        }
+
+        offsets.resize(num_offsets);
+        std::memcpy(offsets.data(), mapped.data + header.data_offset,
+            num_offsets * sizeof(std::uint64_t));
+
+        for (std::size_t k = 0; k < num_offsets; ++k)
+        {
+            if (offsets[k] > mapped.size || (k > 0 && offsets[k] < offsets[k - 1]))
+            {
+                std::cerr << "Error: grid file " << grid_path << " is truncated!" << std::endl;
+                std::exit(1);
+            }
+        }
+
+        parse_planes = [&](std::size_t thread)
+        {
+            for (std::size_t k = start_k + thread; k < end_k; k += num_threads)
+            {
+                char const* it = mapped.data + offsets[k];
+                char const* const end = mapped.data + offsets[k + 1];
+
+                if (!header.run_length)
+                {
+                    if (static_cast<std::size_t>(end - it) < row_size * (header.j_max + 2) * sizeof(std::uint16_t))
+                    {
+                        failed = true;
+                        return;
+                    }
+
+                    for (std::size_t j = start_j; j < end_j; ++j)
+                    {
+                        for (std::size_t i = start_i; i < end_i; ++i)
+                        {
+                            std::uint16_t value;
+                            std::memcpy(&value, it + (j * row_size + i) * sizeof(value), sizeof(value));
+
+                            store(value, i, j, k, thread);
+                        }
+                    }
+
+                    continue;
+                }
+
+                // runs may span rows, only the cells of the partition are kept
+                std::size_t pos = 0;
+                std::size_t const local_end = end_j * row_size;
+
+                for (; it + 2 * sizeof(std::uint16_t) <= end && pos < local_end;
+                        it += 2 * sizeof(std::uint16_t))
+                {
+                    std::uint16_t count, value;
+                    std::memcpy(&count, it, sizeof(count));
+                    std::memcpy(&value, it + sizeof(count), sizeof(value));
+
+                    std::size_t const run_end = pos + count;
+
+                    for (std::size_t j = std::max(pos / row_size, start_j);
+                            j < end_j && j * row_size < run_end; ++j)
+                    {
+                        std::size_t const first = std::max(pos, j * row_size + start_i);
+                        std::size_t const last = std::min(run_end, j * row_size + end_i);
+
+                        for (std::size_t cell = first; cell < last; ++cell)
+                            store(value, cell - j * row_size, j, k, thread);
+                    }
+
+                    pos = run_end;
+                }
+
+                if (pos < local_end)
+                {
+                    failed = true;
+                    return;
+                }
+            }
+        };
+    }
+    else
+    {
+        offsets = plane_offsets(grid_path, header, write_index_file);
+
+        parse_planes = [&](std::size_t thread)
+        {
+            std::ifstream file(grid_path, std::ios::binary);
+            std::string plane;
+
+            for (std::size_t k = start_k + thread; k < end_k; k += num_threads)
+            {
+                plane.resize(offsets[k + 1] - offsets[k]);
+
+                file.seekg(offsets[k]);
+                file.read(&plane[0], plane.size());
+
+                if (!file)
+                {
+                    failed = true;
+                    return;
+                }
+
+                char const* it = plane.c_str();
+                char const* const end = it + plane.size();
+
+                for (std::size_t row = 0; row < header.j_max + 2 && it < end; ++row)
+                {
+                    std::size_t const j = header.j_max + 1 - row;
+
+                    char const* line_end = static_cast<char const*>(std::memchr(it, '\n', end - it));
+                    if (line_end == NULL)
+                        line_end = end;
+
+                    if (j >= start_j && j < end_j)
+                    {
+                        char* cell = const_cast<char*>(it);
+
+                        for (std::size_t i = 0; i < end_i; ++i)
+                        {
+                            char* next;
+                            unsigned long const value = std::strtoul(cell, &next, 10);
+
+                            if (next == cell)
+                            {
+                                failed = true;
+                                return;
+                            }
+
+                            if (i >= start_i)
+                                store(value, i, j, k, thread);
+
+                            // skip the separating comma
+                            cell = next + 1;
+                        }
+                    }
+
+                    it = line_end + 1;
+                }
+            }
+        };
+    }
+
+    std::vector<std::thread> threads;
+    threads.reserve(num_threads - 1);
+
+    for (std::size_t thread = 1; thread < num_threads; ++thread)
+        threads.emplace_back(parse_planes, thread);
+
+    parse_planes(0);
+
+    for (auto& thread : threads)
+        thread.join();
+
+    if (failed)
+    {
+        std::cerr << "Error: could not parse grid file " << grid_path << "!" << std::endl;
+        std::exit(1);
+    }
+
+    std::size_t num_fluid_cells = 0;
+    for (std::size_t count : fluid_cells)
+        num_fluid_cells += count;
+
+    return num_fluid_cells;
+}
+
+}
+}
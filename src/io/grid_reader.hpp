@@ -0,0 +1,76 @@
+#ifndef NAST_HPX_IO_GRID_READER_HPP_
+#define NAST_HPX_IO_GRID_READER_HPP_
+
+#include "config.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace nast_hpx { namespace io {
+
+/// First bytes of a binary grid file.
+char const binary_grid_magic[8] = {'N', 'A', 'S', 'T', 'G', 'R', 'D', '1'};
+
+/// Header of a binary grid file. It is followed by the byte offsets of the
+/// k_max + 2 planes plus the end of the last one as uint64_t and the planes.
+/// A plane holds its rows from j = 0 up, each with its cells from i = 0 up as
+/// uint16_t flags, or (count, flag) pairs of uint16_t if it is run-length
+/// compressed.
+struct binary_grid_header
+{
+    char magic[8];
+
+    std::uint32_t i_max;
+    std::uint32_t j_max;
+    std::uint32_t k_max;
+    std::uint32_t run_length;
+
+    double x_length;
+    double y_length;
+    double z_length;
+};
+
+/// Geometry stored in the header of a grid file.
+struct grid_header
+{
+    uint i_max;
+    uint j_max;
+    uint k_max;
+
+    double x_length;
+    double y_length;
+    double z_length;
+
+    std::uint64_t data_offset;
+
+    bool binary;
+    bool run_length;
+};
+
+/// Reads the flags of a single partition from a grid file.
+///
+/// A csv grid file holds one line of i_max + 2 comma separated flags per row,
+/// rows of a plane from j = j_max + 1 down to j = 0 and planes from k = 0 up
+/// to k = k_max + 1. The byte offset of every plane is kept in an index next
+/// to the grid file (grid_path + ".idx"), so a locality seeks straight to its
+/// own planes and parses them in parallel instead of parsing the whole file.
+/// Binary grid files carry their plane offsets and are memory-mapped.
+struct grid_reader
+{
+    static grid_header read_header(const char* grid_path);
+
+    /// Fills cfg.flag_grid with the partition (idx, idy, idz) and returns the
+    /// number of fluid cells in it. If write_index is set, a missing or stale
+    /// index is written back next to the grid file.
+    static std::size_t read_partition(const char* grid_path, grid_header const& header,
+        config& cfg, std::size_t idx, std::size_t idy, std::size_t idz, bool write_index);
+
+private:
+    static std::vector<std::uint64_t> plane_offsets(const char* grid_path,
+        grid_header const& header, bool write_index);
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef NAST_HPX_IO_MONITOR_HPP_
+#define NAST_HPX_IO_MONITOR_HPP_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace nast_hpx { namespace io {
+
+/// Quantity evaluated in-situ and appended to the monitor time series.
+/// Every locality contributes partial sums, the root combines them.
+struct monitor
+{
+    enum monitor_type
+    {
+        probe,              ///< u, v, w, p at the cell
+        plane_average,      ///< mean u, v, w, p over the fluid cells of plane cell[axis]
+        kinetic_energy,     ///< integral of |u|^2 / 2 over the fluid
+        pressure_drop       ///< mean p on plane cell[axis] minus the one on plane second
+    };
+
+    std::string name;
+    std::size_t type;
+    std::size_t axis;
+    std::size_t cell[3];
+    std::size_t second;
+
+    /// number of partial sums reduced to the root
+    std::size_t num_sums() const
+    {
+        switch (type)
+        {
+            case probe:
+            case plane_average:
+                return 5;
+            case pressure_drop:
+                return 4;
+        }
+
+        return 1;
+    }
+
+    /// names of the columns in the time series
+    std::vector<std::string> columns() const
+    {
+        if (type == probe || type == plane_average)
+            return {name + "_u", name + "_v", name + "_w", name + "_p"};
+
+        return {name};
+    }
+
+    template <typename Archive>
+    void serialize(Archive& ar, const unsigned int version)
+    {
+        ar & name & type & axis & cell[0] & cell[1] & cell[2] & second;
+    }
+};
+
+}
+}
+
+#endif
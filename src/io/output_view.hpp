@@ -0,0 +1,72 @@
+#ifndef NAST_HPX_IO_OUTPUT_VIEW_HPP_
+#define NAST_HPX_IO_OUTPUT_VIEW_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <string>
+
+namespace nast_hpx { namespace io {
+
+/// Part of the domain written at its own interval: every stride-th cell of
+/// the global cells begin to end (inclusive) in each direction. Volumes,
+/// planes and boxes of the config are all mapped onto this.
+struct output_view
+{
+    std::string name;
+
+    std::size_t begin[3];
+    std::size_t end[3];
+    std::size_t stride;
+
+    double interval;
+
+    std::size_t num_samples(std::size_t axis) const
+    {
+        return (end[axis] - begin[axis]) / stride + 1;
+    }
+
+    /// global index of the cell a sample is taken from
+    std::size_t cell(std::size_t axis, std::size_t sample) const
+    {
+        return begin[axis] + sample * stride;
+    }
+
+    /// finds the samples [first, last] along axis taken from the global
+    /// cells lo to hi, returns false if there are none
+    bool samples_in(std::size_t axis, std::size_t lo, std::size_t hi,
+        std::size_t& first, std::size_t& last) const
+    {
+        std::size_t const from = std::max(lo, begin[axis]);
+        std::size_t const to = std::min(hi, end[axis]);
+
+        if (from > to)
+            return false;
+
+        first = (from - begin[axis] + stride - 1) / stride;
+        last = (to - begin[axis]) / stride;
+
+        return first <= last;
+    }
+
+    template <typename Archive>
+    void serialize(Archive& ar, const unsigned int version)
+    {
+        ar & name & begin[0] & begin[1] & begin[2] & end[0] & end[1] & end[2]
+            & stride & interval;
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, output_view const& view)
+    {
+        os  << view.name << " [" << view.begin[0] << ":" << view.end[0]
+            << ", " << view.begin[1] << ":" << view.end[1]
+            << ", " << view.begin[2] << ":" << view.end[2]
+            << "] stride " << view.stride << " every " << view.interval;
+        return os;
+    }
+};
+
+}
+}
+
+#endif
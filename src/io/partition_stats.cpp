@@ -0,0 +1,130 @@
+#include "partition_stats.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace nast_hpx { namespace io {
+
+namespace {
+
+    // more partitions are only summarized
+    std::size_t const max_listed = 64;
+
+    double ratio(std::size_t halo, std::size_t cells)
+    {
+        return cells > 0 ? static_cast<double>(halo) / cells : 0.;
+    }
+}
+
+partition_stats partition_stats::compute(config const& cfg)
+{
+    partition_stats stats{0, 0, 0, 0, 0};
+
+    std::size_t const nx = cfg.cells_x_per_partition;
+    std::size_t const ny = cfg.cells_y_per_partition;
+    std::size_t const nz = cfg.cells_z_per_partition;
+
+    // the cells of the partition without the halo layer, the domain boundary
+    // is also flagged as obstacle but only counted as boundary, so the three
+    // columns add up to nx * ny * nz
+    for (std::size_t k = 1; k <= nz; ++k)
+        for (std::size_t j = 1; j <= ny; ++j)
+            for (std::size_t i = 1; i <= nx; ++i)
+            {
+                auto const& flag = cfg.flag_grid[(k * (ny + 2) + j) * (nx + 2) + i];
+
+                if (flag.test(is_fluid))
+                    ++stats.fluid_cells;
+                else if (flag.test(is_boundary))
+                    ++stats.boundary_cells;
+                else if (flag.test(is_obstacle))
+                    ++stats.obstacle_cells;
+            }
+
+    bool const left = cfg.idx > 0;
+    bool const right = cfg.idx < cfg.num_localities_x - 1;
+    bool const front = cfg.idy > 0;
+    bool const back = cfg.idy < cfg.num_localities_y - 1;
+    bool const bottom = cfg.idz > 0;
+    bool const top = cfg.idz < cfg.num_localities_z - 1;
+
+    // the faces, as sent by partition_server::send_boundaries_*
+    std::size_t const faces = (left + right) * ny * nz + (front + back) * nx * nz
+        + (bottom + top) * nx * ny;
+
+    stats.halo_per_iteration = faces;
+
+    // U, V and W go to all faces and two edges each, F, G and H to one face
+    stats.halo_per_step = 3 * faces
+        + (front && right) * nz + (bottom && right) * ny
+        + (back && left) * nz + (back && bottom) * nx
+        + (top && left) * ny + (front && top) * nx
+        + right * ny * nz + back * nx * nz + top * nx * ny;
+
+    return stats;
+}
+
+void partition_stats::report(std::ostream& os, std::vector<partition_stats> const& stats,
+    config const& cfg, bool list)
+{
+    std::size_t total_fluid = 0;
+    std::size_t total_halo = 0;
+    std::size_t max_fluid = 0;
+    std::size_t min_fluid = stats.empty() ? 0 : stats[0].fluid_cells;
+    std::size_t max_rank = 0;
+    double max_ratio = 0;
+
+    for (std::size_t rank = 0; rank < stats.size(); ++rank)
+    {
+        partition_stats const& s = stats[rank];
+
+        total_fluid += s.fluid_cells;
+        total_halo += s.halo_per_iteration;
+        min_fluid = std::min(min_fluid, s.fluid_cells);
+        max_ratio = std::max(max_ratio, ratio(s.halo_per_iteration, s.fluid_cells));
+
+        if (s.fluid_cells > max_fluid)
+        {
+            max_fluid = s.fluid_cells;
+            max_rank = rank;
+        }
+    }
+
+    double const mean_fluid = stats.empty() ? 0. : static_cast<double>(total_fluid) / stats.size();
+
+    os << "Decomposition of " << cfg.i_max + 2 << "x" << cfg.j_max + 2 << "x" << cfg.k_max + 2
+        << " cells into " << cfg.num_localities_x << "x" << cfg.num_localities_y << "x"
+        << cfg.num_localities_z << " partitions of " << cfg.cells_x_per_partition << "x"
+        << cfg.cells_y_per_partition << "x" << cfg.cells_z_per_partition << "\n";
+
+    char line[160];
+
+    if (list && stats.size() <= max_listed)
+    {
+        std::snprintf(line, sizeof(line), "%6s %12s %12s %12s %12s %12s %10s",
+            "rank", "fluid", "obstacle", "boundary", "halo/step", "halo/iter", "halo/cell");
+        os << line << "\n";
+
+        for (std::size_t rank = 0; rank < stats.size(); ++rank)
+        {
+            partition_stats const& s = stats[rank];
+
+            std::snprintf(line, sizeof(line), "%6zu %12zu %12zu %12zu %12zu %12zu %10.4f",
+                rank, s.fluid_cells, s.obstacle_cells, s.boundary_cells, s.halo_per_step,
+                s.halo_per_iteration, ratio(s.halo_per_iteration, s.fluid_cells));
+            os << line << "\n";
+        }
+    }
+
+    // the stencils work on the fluid cells, the slowest partition sets the pace
+    os << "Fluid cells per partition: min " << min_fluid << ", mean " << mean_fluid
+        << ", max " << max_fluid << " on rank " << max_rank << "\n"
+        << "Predicted imbalance factor (max / mean fluid cells): "
+        << (mean_fluid > 0 ? max_fluid / mean_fluid : 0.) << "\n"
+        << "Communication to computation per pressure iteration (halo values / fluid cells): "
+        << ratio(total_halo, total_fluid) << " overall, " << max_ratio << " worst partition"
+        << std::endl;
+}
+
+}
+}
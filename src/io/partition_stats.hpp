@@ -0,0 +1,45 @@
+#ifndef NAST_HPX_IO_PARTITION_STATS_HPP_
+#define NAST_HPX_IO_PARTITION_STATS_HPP_
+
+#include "config.hpp"
+
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+namespace nast_hpx { namespace io {
+
+/// Cells and halo volume of the partition of a locality, known from the
+/// flags before the partition is allocated.
+struct partition_stats
+{
+    /// disjoint, they add up to the cells of the partition
+    std::size_t fluid_cells;
+    std::size_t obstacle_cells;
+    std::size_t boundary_cells;
+
+    /// values sent per timestep for the velocities and F, G, H
+    std::size_t halo_per_step;
+
+    /// values sent per iteration of the pressure solver
+    std::size_t halo_per_iteration;
+
+    /// from the flags and position of the partition of cfg
+    static partition_stats compute(config const& cfg);
+
+    /// predicted imbalance and communication of all partitions, in the
+    /// order of the ranks, optionally listing every partition
+    static void report(std::ostream& os, std::vector<partition_stats> const& stats,
+        config const& cfg, bool list);
+
+    template <typename Archive>
+    void serialize(Archive& ar, const unsigned int version)
+    {
+        ar & fluid_cells & obstacle_cells & boundary_cells & halo_per_step & halo_per_iteration;
+    }
+};
+
+}
+}
+
+#endif
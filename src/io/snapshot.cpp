@@ -0,0 +1,286 @@
+#include "snapshot.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#ifdef NAST_HPX_WITH_ZLIB
+#include <zlib.h>
+#endif
+
+namespace nast_hpx { namespace io {
+
+namespace {
+
+    /// a field block starts with its mode
+    enum field_mode : char
+    {
+        exact = 0,
+        quantized = 1
+    };
+
+    /// groups byte b of all values together
+    std::vector<char> shuffle(char const* data, std::size_t count, std::size_t width)
+    {
+        std::vector<char> shuffled(count * width);
+
+        for (std::size_t i = 0; i < count; ++i)
+            for (std::size_t b = 0; b < width; ++b)
+                shuffled[b * count + i] = data[i * width + b];
+
+        return shuffled;
+    }
+
+    void unshuffle(char const* shuffled, std::size_t count, std::size_t width, char* data)
+    {
+        for (std::size_t i = 0; i < count; ++i)
+            for (std::size_t b = 0; b < width; ++b)
+                data[i * width + b] = shuffled[b * count + i];
+    }
+
+    /// appends the shuffled values to block, deflated if built with zlib
+    void pack(std::vector<char>& block, char const* data, std::size_t count, std::size_t width)
+    {
+        std::vector<char> shuffled = shuffle(data, count, width);
+
+#ifdef NAST_HPX_WITH_ZLIB
+        uLongf size = compressBound(shuffled.size());
+        std::size_t const pos = block.size();
+        block.resize(pos + size);
+
+        // in-situ compression favours speed over ratio, the snapshot header
+        // marks all blocks as deflated, so a failure can not be stored raw
+        if (compress2(reinterpret_cast<Bytef*>(&block[pos]), &size,
+                reinterpret_cast<Bytef const*>(shuffled.data()), shuffled.size(), Z_BEST_SPEED)
+            != Z_OK)
+        {
+            std::cerr << "Error: could not compress a snapshot block!" << std::endl;
+            std::exit(1);
+        }
+
+        block.resize(pos + size);
+#else
+        block.insert(block.end(), shuffled.begin(), shuffled.end());
+#endif
+    }
+
+    void unpack(char const* block, std::size_t size, std::size_t count, std::size_t width,
+        bool deflated, char* data)
+    {
+        std::vector<char> shuffled(count * width);
+
+        if (deflated)
+        {
+#ifdef NAST_HPX_WITH_ZLIB
+            uLongf length = shuffled.size();
+
+            if (uncompress(reinterpret_cast<Bytef*>(shuffled.data()), &length,
+                    reinterpret_cast<Bytef const*>(block), size) != Z_OK
+                || length != shuffled.size())
+            {
+                std::cerr << "Error: corrupt snapshot block!" << std::endl;
+                std::exit(1);
+            }
+#else
+            std::cerr << "Error: deflated snapshots need a build with zlib!" << std::endl;
+            std::exit(1);
+#endif
+        }
+        else
+        {
+            if (size != shuffled.size())
+            {
+                std::cerr << "Error: corrupt snapshot block!" << std::endl;
+                std::exit(1);
+            }
+
+            std::memcpy(shuffled.data(), block, size);
+        }
+
+        unshuffle(shuffled.data(), count, width, data);
+    }
+}
+
+std::vector<char> snapshot::compress_field(std::vector<double> const& values,
+    double error_bound)
+{
+    std::vector<char> block(1, exact);
+
+    if (error_bound > 0)
+    {
+        // quantization steps of twice the bound keep every value within it,
+        // the deltas of smooth fields only fill the low bytes
+        double const step = 2 * error_bound;
+        double const limit = std::ldexp(1., 62);
+
+        std::vector<std::uint64_t> deltas(values.size());
+        std::int64_t previous = 0;
+        bool representable = true;
+
+        for (std::size_t i = 0; i < values.size(); ++i)
+        {
+            double const q = std::round(values[i] / step);
+            representable = std::fabs(q) < limit;
+
+            if (!representable)
+                break;
+
+            std::int64_t const current = static_cast<std::int64_t>(q);
+            std::int64_t const delta = current - previous;
+            previous = current;
+
+            deltas[i] = (static_cast<std::uint64_t>(delta) << 1)
+                ^ static_cast<std::uint64_t>(delta >> 63);
+        }
+
+        // values too large for the bound are stored exactly
+        if (representable)
+        {
+            block[0] = quantized;
+            pack(block, reinterpret_cast<char const*>(deltas.data()), deltas.size(),
+                sizeof(std::uint64_t));
+
+            return block;
+        }
+    }
+
+    pack(block, reinterpret_cast<char const*>(values.data()), values.size(), sizeof(double));
+
+    return block;
+}
+
+std::vector<double> snapshot::decompress_field(std::vector<char> const& block,
+    std::size_t count, double error_bound, bool deflated)
+{
+    std::vector<double> values(count);
+
+    if (block.empty())
+    {
+        std::cerr << "Error: corrupt snapshot block!" << std::endl;
+        std::exit(1);
+    }
+
+    if (block[0] == exact)
+    {
+        unpack(block.data() + 1, block.size() - 1, count, sizeof(double), deflated,
+            reinterpret_cast<char*>(values.data()));
+
+        return values;
+    }
+
+    std::vector<std::uint64_t> deltas(count);
+    unpack(block.data() + 1, block.size() - 1, count, sizeof(std::uint64_t), deflated,
+        reinterpret_cast<char*>(deltas.data()));
+
+    std::int64_t current = 0;
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        std::int64_t const delta =
+            static_cast<std::int64_t>(deltas[i] >> 1) ^ -static_cast<std::int64_t>(deltas[i] & 1);
+
+        current += delta;
+        values[i] = current * 2 * error_bound;
+    }
+
+    return values;
+}
+
+std::vector<char> snapshot::compress_flags(std::vector<std::uint16_t> const& flags)
+{
+    std::vector<char> block;
+    pack(block, reinterpret_cast<char const*>(flags.data()), flags.size(), sizeof(std::uint16_t));
+
+    return block;
+}
+
+std::vector<std::uint16_t> snapshot::decompress_flags(std::vector<char> const& block,
+    std::size_t count, bool deflated)
+{
+    std::vector<std::uint16_t> flags(count);
+    unpack(block.data(), block.size(), count, sizeof(std::uint16_t), deflated,
+        reinterpret_cast<char*>(flags.data()));
+
+    return flags;
+}
+
+bool snapshot::deflates()
+{
+#ifdef NAST_HPX_WITH_ZLIB
+    return true;
+#else
+    return false;
+#endif
+}
+
+void snapshot::write(std::string const& filename, snapshot_header const& header,
+    std::vector<char> const& flags, std::vector<std::vector<char> > const& fields)
+{
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+
+    file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+
+    auto write_block = [&file](std::vector<char> const& block)
+    {
+        std::uint64_t const size = block.size();
+        file.write(reinterpret_cast<char const*>(&size), sizeof(size));
+        file.write(block.data(), block.size());
+    };
+
+    write_block(flags);
+
+    for (auto const& field : fields)
+        write_block(field);
+
+    if (!file)
+        std::cerr << "Error: could not write snapshot " << filename << "!" << std::endl;
+}
+
+snapshot_header snapshot::read(std::string const& filename, std::vector<std::uint16_t>& flags,
+    std::vector<std::vector<double> >& fields)
+{
+    std::ifstream file(filename, std::ios::binary);
+
+    snapshot_header header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+    if (!file || std::memcmp(header.magic, snapshot_magic, sizeof(snapshot_magic)) != 0)
+    {
+        std::cerr << "Error: " << filename << " is not a snapshot!" << std::endl;
+        std::exit(1);
+    }
+
+    auto read_block = [&file, &filename]()
+    {
+        std::uint64_t size = 0;
+        file.read(reinterpret_cast<char*>(&size), sizeof(size));
+
+        std::vector<char> block(size);
+        file.read(block.data(), size);
+
+        if (!file)
+        {
+            std::cerr << "Error: snapshot " << filename << " is truncated!" << std::endl;
+            std::exit(1);
+        }
+
+        return block;
+    };
+
+    std::size_t const count =
+        static_cast<std::size_t>(header.cells_x) * header.cells_y * header.cells_z;
+
+    flags = decompress_flags(read_block(), count, header.deflated != 0);
+
+    fields.clear();
+    for (std::uint32_t field = 0; field < header.num_fields; ++field)
+        fields.push_back(decompress_field(read_block(), count, header.error_bound,
+            header.deflated != 0));
+
+    return header;
+}
+
+}
+}
@@ -0,0 +1,77 @@
+#ifndef NAST_HPX_IO_SNAPSHOT_HPP_
+#define NAST_HPX_IO_SNAPSHOT_HPP_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace nast_hpx { namespace io {
+
+/// First bytes of a compressed snapshot file.
+char const snapshot_magic[8] = {'N', 'A', 'S', 'T', 'S', 'N', 'P', '1'};
+
+/// Header of the compressed snapshot of a single locality. It is followed
+/// by the flags and the num_fields fields (pressure and cell centered u, v,
+/// w of the interior cells, i fastest), each as UInt64 size and its bytes.
+struct snapshot_header
+{
+    char magic[8];
+
+    std::uint32_t i_max;
+    std::uint32_t j_max;
+    std::uint32_t k_max;
+    std::uint32_t cells_x;
+    std::uint32_t cells_y;
+    std::uint32_t cells_z;
+    std::uint32_t idx;
+    std::uint32_t idy;
+    std::uint32_t idz;
+    std::uint32_t res_x;
+    std::uint32_t res_y;
+    std::uint32_t res_z;
+
+    /// 1 if the blocks are deflated, 0 if they are only shuffled
+    std::uint32_t deflated;
+    std::uint32_t num_fields;
+
+    std::uint64_t step;
+    double t;
+    double dx;
+    double dy;
+    double dz;
+
+    /// 0 for lossless fields, else the maximum absolute error
+    double error_bound;
+};
+
+/// Compression of snapshot fields: doubles are either stored exactly or
+/// quantized to multiples of twice the error bound and delta coded along
+/// i. The bytes are shuffled, so that equal bytes of neighbouring values
+/// are adjacent, and deflated if built with zlib.
+struct snapshot
+{
+    static std::vector<char> compress_field(std::vector<double> const& values,
+        double error_bound);
+
+    static std::vector<double> decompress_field(std::vector<char> const& block,
+        std::size_t count, double error_bound, bool deflated);
+
+    static std::vector<char> compress_flags(std::vector<std::uint16_t> const& flags);
+
+    static std::vector<std::uint16_t> decompress_flags(std::vector<char> const& block,
+        std::size_t count, bool deflated);
+
+    /// true if the blocks written by this build are deflated
+    static bool deflates();
+
+    static void write(std::string const& filename, snapshot_header const& header,
+        std::vector<char> const& flags, std::vector<std::vector<char> > const& fields);
+
+    static snapshot_header read(std::string const& filename, std::vector<std::uint16_t>& flags,
+        std::vector<std::vector<double> >& fields);
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,225 @@
+#include "telemetry.hpp"
+
+#include "util/phase_timer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+namespace nast_hpx { namespace io {
+
+namespace {
+
+    struct pending_record
+    {
+        double t = 0;
+        double dt = 0;
+        std::vector<std::pair<std::size_t, double> > residuals;
+        bool converged = false;
+
+        bool has_velocity = false;
+        double max_velocity[3] = {0, 0, 0};
+    };
+
+    struct stream_state
+    {
+        std::atomic<bool> enabled{false};
+        std::string filename;
+        std::size_t buffered_records = 0;
+
+        /// records still missing the convergence or the max velocity
+        std::map<std::size_t, pending_record> pending;
+        std::vector<std::string> lines;
+
+        std::uint64_t phase_times[util::phase_timer::num_phases] = {};
+
+        std::mutex mtx;
+        std::mutex file_mtx;
+    };
+
+    stream_state& state()
+    {
+        static stream_state s;
+        return s;
+    }
+
+    std::string format(std::size_t step, pending_record& record, stream_state& s)
+    {
+        std::sort(record.residuals.begin(), record.residuals.end());
+
+        std::ostringstream os;
+        os.precision(12);
+
+        os  << "{\"step\":" << step
+            << ",\"t\":" << record.t
+            << ",\"dt\":" << record.dt
+            << ",\"iterations\":"
+                << (record.residuals.empty() ? 0 : record.residuals.back().first + 1)
+            << ",\"residual\":[";
+
+        for (std::size_t i = 0; i < record.residuals.size(); ++i)
+            os << (i == 0 ? "" : ",") << record.residuals[i].second;
+
+        os  << "],\"max_velocity\":[" << record.max_velocity[0] << ","
+                << record.max_velocity[1] << "," << record.max_velocity[2] << "]";
+
+        if (!record.converged || !record.has_velocity)
+            os << ",\"complete\":false";
+
+        os  << ",\"phases\":{";
+
+        // the phases of consecutive steps overlap, so this is the time
+        // accumulated since the record before
+        for (std::size_t p = 0; p < util::phase_timer::num_phases; ++p)
+        {
+            util::phase_timer::phase const phase = static_cast<util::phase_timer::phase>(p);
+            std::uint64_t const time = util::phase_timer::time(phase);
+
+            os  << (p == 0 ? "" : ",") << "\"" << util::phase_timer::name(phase) << "\":"
+                << time - s.phase_times[p];
+
+            s.phase_times[p] = time;
+        }
+
+        os << "}}\n";
+
+        return os.str();
+    }
+
+    void write_lines(stream_state& s, std::vector<std::string> const& lines)
+    {
+        if (lines.empty())
+            return;
+
+        std::lock_guard<std::mutex> l(s.file_mtx);
+        std::ofstream file(s.filename, std::ios::app);
+
+        for (auto const& line : lines)
+            file << line;
+
+        if (!file)
+            std::cerr << "Error: could not write " << s.filename << "!" << std::endl;
+    }
+
+    /// moves a complete record into the lines, hands back a full batch
+    void complete(std::size_t step, stream_state& s, std::vector<std::string>& batch)
+    {
+        auto it = s.pending.find(step);
+        if (!it->second.converged || !it->second.has_velocity)
+            return;
+
+        // the converged residual of an older step may have been dropped
+        // with its cancelled solve, it is written with what it has. The
+        // step right before may still complete under dtLookahead.
+        for (auto older = s.pending.begin(); older != it && older->first + 1 < step; )
+        {
+            s.lines.push_back(format(older->first, older->second, s));
+            older = s.pending.erase(older);
+        }
+
+        s.lines.push_back(format(step, it->second, s));
+        s.pending.erase(it);
+
+        if (s.lines.size() >= s.buffered_records)
+            batch.swap(s.lines);
+    }
+}
+
+void telemetry::open(std::string const& filename, std::size_t buffered_records, bool append)
+{
+    stream_state& s = state();
+
+    std::lock_guard<std::mutex> l(s.mtx);
+
+    s.filename = filename;
+    s.buffered_records = buffered_records;
+    s.enabled = true;
+
+    for (std::size_t p = 0; p < util::phase_timer::num_phases; ++p)
+        s.phase_times[p] = util::phase_timer::time(static_cast<util::phase_timer::phase>(p));
+
+    std::ofstream file(filename, append ? std::ios::app : std::ios::trunc);
+
+    if (!file)
+        std::cerr << "Error: could not open " << filename << "!" << std::endl;
+}
+
+bool telemetry::enabled()
+{
+    return state().enabled;
+}
+
+void telemetry::record_residual(std::size_t step, double t, double dt, std::size_t iter,
+    double residual, bool final)
+{
+    stream_state& s = state();
+    std::vector<std::string> batch;
+
+    {
+        std::lock_guard<std::mutex> l(s.mtx);
+
+        if (!s.enabled)
+            return;
+
+        pending_record& record = s.pending[step];
+        record.t = t;
+        record.dt = dt;
+        record.residuals.emplace_back(iter, residual);
+        record.converged = record.converged || final;
+
+        complete(step, s, batch);
+    }
+
+    write_lines(s, batch);
+}
+
+void telemetry::record_velocity(std::size_t step, double max_u, double max_v, double max_w)
+{
+    stream_state& s = state();
+    std::vector<std::string> batch;
+
+    {
+        std::lock_guard<std::mutex> l(s.mtx);
+
+        if (!s.enabled)
+            return;
+
+        pending_record& record = s.pending[step];
+        record.has_velocity = true;
+        record.max_velocity[0] = max_u;
+        record.max_velocity[1] = max_v;
+        record.max_velocity[2] = max_w;
+
+        complete(step, s, batch);
+    }
+
+    write_lines(s, batch);
+}
+
+void telemetry::flush()
+{
+    stream_state& s = state();
+    std::vector<std::string> batch;
+
+    {
+        std::lock_guard<std::mutex> l(s.mtx);
+
+        for (auto& record : s.pending)
+            s.lines.push_back(format(record.first, record.second, s));
+
+        s.pending.clear();
+        batch.swap(s.lines);
+    }
+
+    write_lines(s, batch);
+}
+
+}
+}
@@ -0,0 +1,34 @@
+#ifndef NAST_HPX_IO_TELEMETRY_HPP_
+#define NAST_HPX_IO_TELEMETRY_HPP_
+
+#include <cstddef>
+#include <string>
+
+namespace nast_hpx { namespace io {
+
+/// Stream of per step solver records on the root, one JSON object per line
+/// with step, t, dt, iterations, the residual of every iteration, the max
+/// velocity and the time of each phase since the record before. A record is
+/// complete once the solver converged and the max velocity is reduced, the
+/// completed ones are appended to the file in batches.
+struct telemetry
+{
+    /// starts the stream, records are only kept after this was called
+    static void open(std::string const& filename, std::size_t buffered_records, bool append);
+
+    static bool enabled();
+
+    /// residual of an iteration, the last one of the step is final
+    static void record_residual(std::size_t step, double t, double dt, std::size_t iter,
+        double residual, bool final);
+
+    static void record_velocity(std::size_t step, double max_u, double max_v, double max_w);
+
+    /// writes the completed records still buffered
+    static void flush();
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,113 @@
+#include "vtk.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#ifdef NAST_HPX_WITH_ZLIB
+#include <zlib.h>
+#endif
+
+namespace nast_hpx { namespace io {
+
+std::vector<char> vtk::encode(char const* data, std::uint64_t bytes, int compression_level)
+{
+    std::vector<char> encoded;
+
+#ifdef NAST_HPX_WITH_ZLIB
+    if (compression_level > 0)
+    {
+        std::uint64_t const block_size = 1 << 20;
+        std::uint64_t const num_blocks = (bytes + block_size - 1) / block_size;
+        std::uint64_t const last_block_size =
+            (num_blocks == 0 || bytes % block_size == 0) ? block_size : bytes % block_size;
+
+        std::vector<std::uint64_t> header(3 + num_blocks);
+        header[0] = num_blocks;
+        header[1] = block_size;
+        header[2] = last_block_size;
+
+        std::size_t const header_bytes = header.size() * sizeof(std::uint64_t);
+        encoded.resize(header_bytes);
+
+        for (std::uint64_t block = 0; block < num_blocks; ++block)
+        {
+            uLong const src_size = (block + 1 == num_blocks) ? last_block_size : block_size;
+            uLongf dest_size = compressBound(src_size);
+
+            std::size_t const pos = encoded.size();
+            encoded.resize(pos + dest_size);
+
+            // the file header already names the compressor, so a block can
+            // not be stored uncompressed instead
+            if (compress2(reinterpret_cast<Bytef*>(&encoded[pos]), &dest_size,
+                    reinterpret_cast<Bytef const*>(data + block * block_size), src_size,
+                    compression_level) != Z_OK)
+            {
+                std::cerr << "Error: could not compress a VTK array!" << std::endl;
+                std::exit(1);
+            }
+
+            encoded.resize(pos + dest_size);
+            header[3 + block] = dest_size;
+        }
+
+        std::memcpy(encoded.data(), header.data(), header_bytes);
+
+        return encoded;
+    }
+#endif
+
+    encoded.resize(sizeof(bytes) + bytes);
+    std::memcpy(encoded.data(), &bytes, sizeof(bytes));
+    std::memcpy(encoded.data() + sizeof(bytes), data, bytes);
+
+    return encoded;
+}
+
+void vtk::write_appended(std::string const& filename, char const* type,
+    std::string const& extent, std::vector<std::vector<char> > const& arrays,
+    int compression_level)
+{
+    std::vector<std::size_t> offsets(arrays.size(), 0);
+    for (std::size_t a = 1; a < arrays.size(); ++a)
+        offsets[a] = offsets[a - 1] + arrays[a - 1].size();
+
+    std::ofstream os(filename, std::ios::binary | std::ios::trunc);
+
+    os  << "<?xml version=\"1.0\"?>\n"
+        << "<VTKFile type=\"RectilinearGrid\" version=\"1.0\" byte_order=\"LittleEndian\""
+            << " header_type=\"UInt64\"";
+
+    if (compression_level > 0)
+        os << " compressor=\"vtkZLibDataCompressor\"";
+
+    os  << ">\n"
+        << "<RectilinearGrid WholeExtent=\"" << extent << "\">\n"
+        << "<Piece Extent=\"" << extent << "\">\n"
+        << "<PointData>\n"
+        << "</PointData>\n"
+        << "<CellData>\n"
+        << "<DataArray type=\"" << type << "\" Name=\"pressure\" format=\"appended\" offset=\"" << offsets[0] << "\"/>\n"
+        << "<DataArray type=\"Int32\" Name=\"obstacle\" format=\"appended\" offset=\"" << offsets[1] << "\"/>\n"
+        << "<DataArray type=\"" << type << "\" Name=\"velocity\" NumberOfComponents=\"3\" format=\"appended\" offset=\"" << offsets[2] << "\"/>\n"
+        << "</CellData>\n"
+        << "<Coordinates>\n"
+        << "<DataArray type=\"" << type << "\" Name=\"X_COORDINATES\" NumberOfComponents=\"1\" format=\"appended\" offset=\"" << offsets[3] << "\"/>\n"
+        << "<DataArray type=\"" << type << "\" Name=\"Y_COORDINATES\" NumberOfComponents=\"1\" format=\"appended\" offset=\"" << offsets[4] << "\"/>\n"
+        << "<DataArray type=\"" << type << "\" Name=\"Z_COORDINATES\" NumberOfComponents=\"1\" format=\"appended\" offset=\"" << offsets[5] << "\"/>\n"
+        << "</Coordinates>\n"
+        << "</Piece>\n"
+        << "</RectilinearGrid>\n"
+        << "<AppendedData encoding=\"raw\">\n_";
+
+    for (auto const& array : arrays)
+        os.write(array.data(), array.size());
+
+    os  << "\n</AppendedData>\n"
+        << "</VTKFile>\n";
+}
+
+}
+}
@@ -0,0 +1,35 @@
+#ifndef NAST_HPX_IO_VTK_HPP_
+#define NAST_HPX_IO_VTK_HPP_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace nast_hpx { namespace io {
+
+/// Pieces of the binary VTK format shared by all writers producing
+/// RectilinearGrids with the arrays in the appended section.
+struct vtk
+{
+    /// Encodes an array for the appended section of a VTK file: UInt64 byte
+    /// count followed by the data, or the vtkZLibDataCompressor block layout.
+    static std::vector<char> encode(char const* data, std::uint64_t bytes, int compression_level);
+
+    template <typename T>
+    static std::vector<char> encode(std::vector<T> const& values, int compression_level)
+    {
+        return encode(reinterpret_cast<char const*>(values.data()), values.size() * sizeof(T),
+            compression_level);
+    }
+
+    /// Writes a VTK RectilinearGrid with the encoded pressure, obstacle,
+    /// velocity and x, y, z coordinate arrays in the appended section.
+    static void write_appended(std::string const& filename, char const* type,
+        std::string const& extent, std::vector<std::vector<char> > const& arrays,
+        int compression_level);
+};
+
+}
+}
+
+#endif
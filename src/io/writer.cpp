@@ -1,19 +1,144 @@
 #include "writer.hpp"
+#include "vtk.hpp"
 
+#include <cstdint>
+#include <cstring>
 #include <fstream>
 #include <sstream>
 #include <vector>
 #include <iomanip>
 #include <limits>
 
+#include <fcntl.h>
+#include <unistd.h>
+
 namespace nast_hpx { namespace io {
 
+namespace {
+
+    /// Writes the samples of an output view taken from one partition.
+    template <typename T>
+    void write_view_vtr(std::string const& filename, output_view const& view,
+        view_piece const& piece, double dx, double dy, double dz, int compression_level)
+    {
+        std::vector<std::vector<char> > arrays;
+
+        arrays.push_back(vtk::encode(std::vector<T>(piece.pressure.begin(), piece.pressure.end()),
+            compression_level));
+        arrays.push_back(vtk::encode(piece.obstacle, compression_level));
+        arrays.push_back(vtk::encode(std::vector<T>(piece.velocity.begin(), piece.velocity.end()),
+            compression_level));
+
+        // a sample covers the cells up to the next one, the last one ends
+        // with the view
+        double const d[3] = {dx, dy, dz};
+
+        for (std::size_t axis = 0; axis < 3; ++axis)
+        {
+            std::vector<T> coordinates;
+
+            for (std::size_t n = piece.first[axis]; n <= piece.last[axis] + 1; ++n)
+            {
+                std::size_t const face = n < view.num_samples(axis)
+                    ? view.cell(axis, n) - 1 : view.end[axis];
+
+                coordinates.push_back(static_cast<T>(d[axis] * face));
+            }
+
+            arrays.push_back(vtk::encode(coordinates, compression_level));
+        }
+
+        std::string const extent =
+            std::to_string(piece.first[0]) + " " + std::to_string(piece.last[0] + 1) + " "
+            + std::to_string(piece.first[1]) + " " + std::to_string(piece.last[1] + 1) + " "
+            + std::to_string(piece.first[2]) + " " + std::to_string(piece.last[2] + 1);
+
+        vtk::write_appended(filename, sizeof(T) == 8 ? "Float64" : "Float32", extent, arrays,
+            compression_level);
+    }
+
+    /// Writes the partition including its halo layer as a VTK RectilinearGrid
+    /// with all arrays in raw binary form in the appended section.
+    template <typename T>
+    void write_appended_vtr(std::string const& filename, grid_type const& p_data,
+        grid_type const& u_data, grid_type const& v_data, grid_type const& w_data,
+        type_grid const& cell_types, int start_x, int end_x, int start_y, int end_y,
+        int start_z, int end_z, double dx, double dy, double dz, int compression_level)
+    {
+        std::size_t const size_x = p_data.size_x_;
+        std::size_t const size_y = p_data.size_y_;
+        std::size_t const size_z = p_data.size_z_;
+        std::size_t const num_cells = size_x * size_y * size_z;
+
+        std::vector<std::vector<char> > arrays;
+
+        {
+            std::vector<T> pressure(num_cells, 0);
+            std::vector<std::int32_t> obstacle(num_cells, 0);
+            std::vector<T> velocity(3 * num_cells, 0);
+
+            for (std::size_t k = 1; k < size_z - 1; ++k)
+                for (std::size_t j = 1; j < size_y - 1; ++j)
+                    for (std::size_t i = 1; i < size_x - 1; ++i)
+                    {
+                        std::size_t const id = k * size_x * size_y + j * size_x + i;
+
+                        if (!cell_types(i, j, k).test(is_fluid))
+                        {
+                            obstacle[id] = 1;
+                            continue;
+                        }
+
+                        pressure[id] = static_cast<T>(p_data(i, j, k));
+                        velocity[3 * id] = static_cast<T>((u_data(i, j, k) + u_data(i - 1, j, k)) / 2.);
+                        velocity[3 * id + 1] = static_cast<T>((v_data(i, j, k) + v_data(i, j - 1, k)) / 2.);
+                        velocity[3 * id + 2] = static_cast<T>((w_data(i, j, k) + w_data(i, j, k - 1)) / 2.);
+                    }
+
+            arrays.push_back(vtk::encode(pressure, compression_level));
+            arrays.push_back(vtk::encode(obstacle, compression_level));
+            arrays.push_back(vtk::encode(velocity, compression_level));
+        }
+
+        // point n of the extent is the lower face of global cell start + n
+        std::vector<T> coordinate_x, coordinate_y, coordinate_z;
+
+        for (int x = 0; x <= end_x - start_x; ++x)
+            coordinate_x.push_back(static_cast<T>(dx * (start_x - 1 + x)));
+
+        for (int y = 0; y <= end_y - start_y; ++y)
+            coordinate_y.push_back(static_cast<T>(dy * (start_y - 1 + y)));
+
+        for (int z = 0; z <= end_z - start_z; ++z)
+            coordinate_z.push_back(static_cast<T>(dz * (start_z - 1 + z)));
+
+        arrays.push_back(vtk::encode(coordinate_x, compression_level));
+        arrays.push_back(vtk::encode(coordinate_y, compression_level));
+        arrays.push_back(vtk::encode(coordinate_z, compression_level));
+
+        std::string const extent =
+            std::to_string(start_x) + " " + std::to_string(end_x) + " "
+            + std::to_string(start_y) + " " + std::to_string(end_y) + " "
+            + std::to_string(start_z) + " " + std::to_string(end_z);
+
+        vtk::write_appended(filename, sizeof(T) == 8 ? "Float64" : "Float32", extent, arrays,
+            compression_level);
+    }
+}
+
 void writer::write_vtk(grid_type const& p_data, grid_type const& u_data,
             grid_type const& v_data, grid_type const& w_data, type_grid const& cell_types,
             std::size_t res_x, std::size_t res_y, std::size_t res_z, std::size_t i_max,
             std::size_t j_max, std::size_t k_max, double dx, double dy, double dz, std::size_t step,
-            std::size_t loc, std::size_t idx, std::size_t idy, std::size_t idz)
+            std::size_t loc, std::size_t idx, std::size_t idy, std::size_t idz,
+            bool binary, bool float64, int compression_level)
 {
+#ifndef NAST_HPX_WITH_ZLIB
+    compression_level = 0;
+#endif
+
+    char const* float_type = float64 ? "Float64" : "Float32";
+
     std::size_t num_localities = res_x * res_y * res_z;
 
     std::size_t cells_x = p_data.size_x_ - 2;
@@ -47,18 +172,18 @@ void writer::write_vtk(grid_type const& p_data, grid_type const& u_data,
           //  << "<DataArray type=\"Float32\" Name=\"heat\" />" << std::endl
             << "</PPointData>" << std::endl
             << "<PCellData>" << std::endl
-            << "<DataArray type=\"Float32\" Name=\"pressure\" />" << std::endl
+            << "<DataArray type=\"" << float_type << "\" Name=\"pressure\" />" << std::endl
             << "<DataArray type=\"Int32\" Name=\"obstacle\" />" << std::endl
           //  << "<DataArray type=\"Float32\" Name=\"temperature\" />" << std::endl
-            << "<DataArray type=\"Float32\" Name=\"velocity\" NumberOfComponents=\"3\" />"
+            << "<DataArray type=\"" << float_type << "\" Name=\"velocity\" NumberOfComponents=\"3\" />"
             << std::endl
             << "</PCellData>" << std::endl
             << "<PCoordinates>" << std::endl
-            << "<PDataArray type=\"Float32\" Name=\"X_COORDINATES\" NumberOfComponents=\"1\"/>"
+            << "<PDataArray type=\"" << float_type << "\" Name=\"X_COORDINATES\" NumberOfComponents=\"1\"/>"
                 << std::endl
-            << "<PDataArray type=\"Float32\" Name=\"Y_COORDINATES\" NumberOfComponents=\"1\"/>"
+            << "<PDataArray type=\"" << float_type << "\" Name=\"Y_COORDINATES\" NumberOfComponents=\"1\"/>"
                 << std::endl
-            << "<PDataArray type=\"Float32\" Name=\"Z_COORDINATES\" NumberOfComponents=\"1\"/>"
+            << "<PDataArray type=\"" << float_type << "\" Name=\"Z_COORDINATES\" NumberOfComponents=\"1\"/>"
                 << std::endl
             << "</PCoordinates>" << std::endl;
 
@@ -95,10 +220,6 @@ void writer::write_vtk(grid_type const& p_data, grid_type const& u_data,
     filename.append (std::to_string(loc));
     filename.append (".vtr");
 
-    std::filebuf fb;
-    fb.open (const_cast < char *>(filename.c_str ()), std::ios::out);
-    std::ostream os (&fb);
-
     int start_x, end_x, start_y, end_y, start_z, end_z;
 
     start_x = cells_x * partitions_x * idx - 1;
@@ -108,6 +229,22 @@ void writer::write_vtk(grid_type const& p_data, grid_type const& u_data,
     start_z = cells_z * partitions_z * idz - 1;
     end_z = cells_z * partitions_z * (idz + 1) + 1;
 
+    if (binary)
+    {
+        if (float64)
+            write_appended_vtr<double>(filename, p_data, u_data, v_data, w_data, cell_types,
+                start_x, end_x, start_y, end_y, start_z, end_z, dx, dy, dz, compression_level);
+        else
+            write_appended_vtr<float>(filename, p_data, u_data, v_data, w_data, cell_types,
+                start_x, end_x, start_y, end_y, start_z, end_z, dx, dy, dz, compression_level);
+
+        return;
+    }
+
+    std::filebuf fb;
+    fb.open (const_cast < char *>(filename.c_str ()), std::ios::out);
+    std::ostream os (&fb);
+
     std::string coordinate_x;
     std::string coordinate_y;
     std::string coordinate_z;
@@ -275,7 +412,7 @@ void writer::write_vtk(grid_type const& p_data, grid_type const& u_data,
        // << "</DataArray>" << std::endl*/
         << "</PointData>" << std::endl
         << "<CellData>" << std::endl
-        << "<DataArray type=\"Float32\" Name=\"pressure\">" << std::endl
+        << "<DataArray type=\"" << float_type << "\" Name=\"pressure\">" << std::endl
         << pdatastring << std::endl
         << "</DataArray>" << std::endl
         << "<DataArray type=\"Int32\" Name=\"obstacle\">" << std::endl
@@ -284,20 +421,20 @@ void writer::write_vtk(grid_type const& p_data, grid_type const& u_data,
         /*<< "<DataArray type=\"Float32\" Name=\"temperature\">" << std::endl
         << tempstring << std::endl
         << "</DataArray>" << std::endl*/
-        << "<DataArray type=\"Float32\" Name=\"velocity\" NumberOfComponents=\"3\">" << std::endl
+        << "<DataArray type=\"" << float_type << "\" Name=\"velocity\" NumberOfComponents=\"3\">" << std::endl
         << uvdatastring << std::endl
         << "</DataArray>" << std::endl
         << "</CellData>" << std::endl
         << "<Coordinates>" << std::endl
-        << "<DataArray type=\"Float32\" Name=\"X_COORDINATES\"  NumberOfComponents=\"1\" format=\"ascii\">"
+        << "<DataArray type=\"" << float_type << "\" Name=\"X_COORDINATES\"  NumberOfComponents=\"1\" format=\"ascii\">"
             << std::endl
         << coordinate_x << std::endl
         << "</DataArray>" << std::endl
-        << "<DataArray type=\"Float32\" Name=\"Y_COORDINATES\"  NumberOfComponents=\"1\" format=\"ascii\">"
+        << "<DataArray type=\"" << float_type << "\" Name=\"Y_COORDINATES\"  NumberOfComponents=\"1\" format=\"ascii\">"
             << std::endl
         << coordinate_y << std::endl
         << "</DataArray>" << std::endl
-        << "<DataArray type=\"Float32\" Name=\"Z_COORDINATES\"  NumberOfComponents=\"1\" format=\"ascii\">"
+        << "<DataArray type=\"" << float_type << "\" Name=\"Z_COORDINATES\"  NumberOfComponents=\"1\" format=\"ascii\">"
             << std::endl
         << coordinate_z << std::endl
         << "</DataArray>" << std::endl
@@ -309,5 +446,504 @@ void writer::write_vtk(grid_type const& p_data, grid_type const& u_data,
     fb.close();
 }
 
+std::uint64_t writer::block_size(std::size_t cells_x, std::size_t cells_y, std::size_t cells_z)
+{
+    std::uint64_t const num_cells = cells_x * cells_y * cells_z;
+    std::uint64_t const bytes = num_cells * (4 * sizeof(double) + sizeof(std::uint16_t));
+
+    return (bytes + 7) / 8 * 8;
+}
+
+std::vector<char> writer::pack_block(grid_type const& p_data, grid_type const& u_data,
+    grid_type const& v_data, grid_type const& w_data, type_grid const& cell_types)
+{
+    std::size_t const cells_x = p_data.size_x_ - 2;
+    std::size_t const cells_y = p_data.size_y_ - 2;
+    std::size_t const cells_z = p_data.size_z_ - 2;
+    std::size_t const num_cells = cells_x * cells_y * cells_z;
+
+    std::vector<char> block(block_size(cells_x, cells_y, cells_z), 0);
+
+    double* pressure = reinterpret_cast<double*>(block.data());
+    double* u = pressure + num_cells;
+    double* v = u + num_cells;
+    double* w = v + num_cells;
+    char* flags = reinterpret_cast<char*>(w + num_cells);
+
+    std::size_t id = 0;
+
+    for (std::size_t k = 1; k <= cells_z; ++k)
+        for (std::size_t j = 1; j <= cells_y; ++j)
+            for (std::size_t i = 1; i <= cells_x; ++i, ++id)
+            {
+                std::uint16_t const flag = static_cast<std::uint16_t>(cell_types(i, j, k).to_ulong());
+                std::memcpy(flags + id * sizeof(flag), &flag, sizeof(flag));
+
+                if (!cell_types(i, j, k).test(is_fluid))
+                    continue;
+
+                pressure[id] = p_data(i, j, k);
+                u[id] = (u_data(i, j, k) + u_data(i - 1, j, k)) / 2.;
+                v[id] = (v_data(i, j, k) + v_data(i, j - 1, k)) / 2.;
+                w[id] = (w_data(i, j, k) + w_data(i, j, k - 1)) / 2.;
+            }
+
+    return block;
+}
+
+std::vector<double> writer::cell_centered(grid_type const& data, type_grid const& cell_types,
+    int staggered_axis)
+{
+    std::size_t const cells_x = data.size_x_ - 2;
+    std::size_t const cells_y = data.size_y_ - 2;
+    std::size_t const cells_z = data.size_z_ - 2;
+
+    std::size_t const di = staggered_axis == 0 ? 1 : 0;
+    std::size_t const dj = staggered_axis == 1 ? 1 : 0;
+    std::size_t const dk = staggered_axis == 2 ? 1 : 0;
+
+    std::vector<double> values(cells_x * cells_y * cells_z, 0.);
+
+    std::size_t id = 0;
+
+    for (std::size_t k = 1; k <= cells_z; ++k)
+        for (std::size_t j = 1; j <= cells_y; ++j)
+            for (std::size_t i = 1; i <= cells_x; ++i, ++id)
+            {
+                if (!cell_types(i, j, k).test(is_fluid))
+                    continue;
+
+                if (staggered_axis < 0)
+                    values[id] = data(i, j, k);
+                else
+                    values[id] = (data(i, j, k) + data(i - di, j - dj, k - dk)) / 2.;
+            }
+
+    return values;
+}
+
+std::vector<std::uint16_t> writer::cell_flags(type_grid const& cell_types)
+{
+    std::size_t const cells_x = cell_types.size_x_ - 2;
+    std::size_t const cells_y = cell_types.size_y_ - 2;
+    std::size_t const cells_z = cell_types.size_z_ - 2;
+
+    std::vector<std::uint16_t> flags;
+    flags.reserve(cells_x * cells_y * cells_z);
+
+    for (std::size_t k = 1; k <= cells_z; ++k)
+        for (std::size_t j = 1; j <= cells_y; ++j)
+            for (std::size_t i = 1; i <= cells_x; ++i)
+                flags.push_back(static_cast<std::uint16_t>(cell_types(i, j, k).to_ulong()));
+
+    return flags;
+}
+
+void writer::write_aggregated(std::vector<std::vector<char> > const& blocks,
+    std::size_t first_loc, std::size_t res_x, std::size_t res_y, std::size_t res_z,
+    std::size_t i_max, std::size_t j_max, std::size_t k_max,
+    std::size_t cells_x, std::size_t cells_y, std::size_t cells_z,
+    double dx, double dy, double dz, double t, std::size_t step)
+{
+    std::size_t const num_localities = res_x * res_y * res_z;
+    std::uint64_t const size = block_size(cells_x, cells_y, cells_z);
+    std::uint64_t const data_offset =
+        sizeof(field_file_header) + num_localities * sizeof(field_file_block);
+
+    std::string filename;
+    filename.append ("./fields/");
+    filename.append ("field_");
+    filename.append (std::to_string(step));
+    filename.append (".nast");
+
+    // the file is shared by all aggregators, so it must not be truncated
+    int fd = open(filename.c_str(), O_WRONLY | O_CREAT, 0644);
+
+    if (fd < 0)
+    {
+        std::cerr << "Error: could not open " << filename << "!" << std::endl;
+        return;
+    }
+
+    if (first_loc == 0)
+    {
+        std::vector<char> header(data_offset);
+
+        field_file_header file_header;
+        std::memset(&file_header, 0, sizeof(file_header));
+        std::memcpy(file_header.magic, field_file_magic, sizeof(file_header.magic));
+
+        file_header.num_blocks = num_localities;
+        file_header.i_max = i_max;
+        file_header.j_max = j_max;
+        file_header.k_max = k_max;
+        file_header.cells_x = cells_x;
+        file_header.cells_y = cells_y;
+        file_header.cells_z = cells_z;
+        file_header.step = step;
+        file_header.t = t;
+        file_header.dx = dx;
+        file_header.dy = dy;
+        file_header.dz = dz;
+        file_header.block_size = size;
+
+        std::memcpy(header.data(), &file_header, sizeof(file_header));
+
+        for (std::size_t loc = 0; loc < num_localities; ++loc)
+        {
+            field_file_block block;
+            block.idx = (loc % (res_x * res_y)) % res_x;
+            block.idy = (loc % (res_x * res_y)) / res_x;
+            block.idz = loc / (res_x * res_y);
+            block.reserved = 0;
+            block.offset = data_offset + loc * size;
+
+            std::memcpy(header.data() + sizeof(file_header) + loc * sizeof(block),
+                &block, sizeof(block));
+        }
+
+        // drop anything left over from an earlier, larger file
+        if (ftruncate(fd, data_offset + num_localities * size) != 0
+            || pwrite(fd, header.data(), header.size(), 0) != static_cast<ssize_t>(header.size()))
+            std::cerr << "Error: could not write header of " << filename << "!" << std::endl;
+    }
+
+    // the blocks of consecutive localities are adjacent in the file
+    std::vector<char> chunk;
+    chunk.reserve(blocks.size() * size);
+
+    for (auto const& block : blocks)
+        chunk.insert(chunk.end(), block.begin(), block.end());
+
+    if (pwrite(fd, chunk.data(), chunk.size(), data_offset + first_loc * size)
+            != static_cast<ssize_t>(chunk.size()))
+        std::cerr << "Error: could not write " << filename << "!" << std::endl;
+
+    close(fd);
+}
+
+bool writer::view_range(output_view const& view, std::size_t cells_x, std::size_t cells_y,
+    std::size_t cells_z, std::size_t idx, std::size_t idy, std::size_t idz,
+    std::size_t first[3], std::size_t last[3])
+{
+    std::size_t const cells[3] = {cells_x, cells_y, cells_z};
+    std::size_t const id[3] = {idx, idy, idz};
+
+    // the interior of a partition holds the global cells id * cells to
+    // (id + 1) * cells - 1
+    for (std::size_t axis = 0; axis < 3; ++axis)
+        if (!view.samples_in(axis, id[axis] * cells[axis], (id[axis] + 1) * cells[axis] - 1,
+                first[axis], last[axis]))
+            return false;
+
+    return true;
+}
+
+view_piece writer::sample_view(output_view const& view, grid_type const& p_data,
+    grid_type const& u_data, grid_type const& v_data, grid_type const& w_data,
+    type_grid const& cell_types, std::size_t idx, std::size_t idy, std::size_t idz)
+{
+    std::size_t const cells_x = p_data.size_x_ - 2;
+    std::size_t const cells_y = p_data.size_y_ - 2;
+    std::size_t const cells_z = p_data.size_z_ - 2;
+
+    view_piece piece;
+
+    if (!view_range(view, cells_x, cells_y, cells_z, idx, idy, idz, piece.first, piece.last))
+        return piece;
+
+    std::size_t const num_samples = (piece.last[0] - piece.first[0] + 1)
+        * (piece.last[1] - piece.first[1] + 1) * (piece.last[2] - piece.first[2] + 1);
+
+    piece.pressure.reserve(num_samples);
+    piece.obstacle.reserve(num_samples);
+    piece.velocity.reserve(3 * num_samples);
+
+    for (std::size_t c = piece.first[2]; c <= piece.last[2]; ++c)
+        for (std::size_t b = piece.first[1]; b <= piece.last[1]; ++b)
+            for (std::size_t a = piece.first[0]; a <= piece.last[0]; ++a)
+            {
+                std::size_t const i = view.cell(0, a) - idx * cells_x + 1;
+                std::size_t const j = view.cell(1, b) - idy * cells_y + 1;
+                std::size_t const k = view.cell(2, c) - idz * cells_z + 1;
+
+                if (!cell_types(i, j, k).test(is_fluid))
+                {
+                    piece.pressure.push_back(0);
+                    piece.obstacle.push_back(1);
+                    piece.velocity.insert(piece.velocity.end(), 3, 0.);
+                    continue;
+                }
+
+                piece.pressure.push_back(p_data(i, j, k));
+                piece.obstacle.push_back(0);
+                piece.velocity.push_back((u_data(i, j, k) + u_data(i - 1, j, k)) / 2.);
+                piece.velocity.push_back((v_data(i, j, k) + v_data(i, j - 1, k)) / 2.);
+                piece.velocity.push_back((w_data(i, j, k) + w_data(i, j, k - 1)) / 2.);
+            }
+
+    return piece;
+}
+
+void writer::write_view(output_view const& view, view_piece const& piece, std::size_t count,
+    std::size_t loc, std::size_t res_x, std::size_t res_y, std::size_t res_z,
+    std::size_t cells_x, std::size_t cells_y, std::size_t cells_z,
+    double dx, double dy, double dz, bool float64, int compression_level)
+{
+#ifndef NAST_HPX_WITH_ZLIB
+    compression_level = 0;
+#endif
+
+    std::string const prefix = "./fields/" + view.name + "_" + std::to_string(count);
+
+    // the root lists the pieces of all localities intersecting the view
+    if (loc == 0)
+    {
+        char const* float_type = float64 ? "Float64" : "Float32";
+
+        std::ofstream os(prefix + ".pvtr", std::ios::trunc);
+
+        os  << "<?xml version=\"1.0\"?>\n"
+            << "<VTKFile type=\"PRectilinearGrid\" version=\"0.1\" byte_order=\"LittleEndian\">\n"
+            << "<PRectilinearGrid WholeExtent=\"0 " << view.num_samples(0)
+                << " 0 " << view.num_samples(1) << " 0 " << view.num_samples(2)
+                << "\" GhostLevel=\"0\">\n"
+            << "<PPointData>\n"
+            << "</PPointData>\n"
+            << "<PCellData>\n"
+            << "<PDataArray type=\"" << float_type << "\" Name=\"pressure\"/>\n"
+            << "<PDataArray type=\"Int32\" Name=\"obstacle\"/>\n"
+            << "<PDataArray type=\"" << float_type << "\" Name=\"velocity\" NumberOfComponents=\"3\"/>\n"
+            << "</PCellData>\n"
+            << "<PCoordinates>\n"
+            << "<PDataArray type=\"" << float_type << "\" Name=\"X_COORDINATES\" NumberOfComponents=\"1\"/>\n"
+            << "<PDataArray type=\"" << float_type << "\" Name=\"Y_COORDINATES\" NumberOfComponents=\"1\"/>\n"
+            << "<PDataArray type=\"" << float_type << "\" Name=\"Z_COORDINATES\" NumberOfComponents=\"1\"/>\n"
+            << "</PCoordinates>\n";
+
+        for (std::size_t other = 0; other < res_x * res_y * res_z; ++other)
+        {
+            std::size_t first[3], last[3];
+
+            if (!view_range(view, cells_x, cells_y, cells_z, (other % (res_x * res_y)) % res_x,
+                    (other % (res_x * res_y)) / res_x, other / (res_x * res_y), first, last))
+                continue;
+
+            os  << "<Piece Extent=\""
+                << first[0] << " " << last[0] + 1 << " "
+                << first[1] << " " << last[1] + 1 << " "
+                << first[2] << " " << last[2] + 1
+                << "\" Source=\"" << view.name << "_" << count
+                << "_locality_" << other << ".vtr\"/>\n";
+        }
+
+        os  << "</PRectilinearGrid>\n"
+            << "</VTKFile>\n";
+    }
+
+    if (piece.pressure.empty())
+        return;
+
+    std::string const filename = prefix + "_locality_" + std::to_string(loc) + ".vtr";
+
+    if (float64)
+        write_view_vtr<double>(filename, view, piece, dx, dy, dz, compression_level);
+    else
+        write_view_vtr<float>(filename, view, piece, dx, dy, dz, compression_level);
+}
+
+std::vector<double> writer::sum_monitors(std::vector<monitor> const& monitors,
+    grid_type const& p_data, grid_type const& u_data, grid_type const& v_data,
+    grid_type const& w_data, type_grid const& cell_types,
+    std::size_t idx, std::size_t idy, std::size_t idz, double dx, double dy, double dz)
+{
+    std::size_t const cells[3] = {p_data.size_x_ - 2, p_data.size_y_ - 2, p_data.size_z_ - 2};
+    std::size_t const id[3] = {idx, idy, idz};
+
+    std::size_t num_sums = 0;
+    for (auto const& m : monitors)
+        num_sums += m.num_sums();
+
+    std::vector<double> sums(num_sums, 0);
+
+    // local index of a global cell, 0 if it is not in the interior
+    auto local = [&](std::size_t axis, std::size_t cell) -> std::size_t
+    {
+        std::size_t const lo = id[axis] * cells[axis];
+
+        if (cell < lo || cell >= lo + cells[axis])
+            return 0;
+
+        return cell - lo + 1;
+    };
+
+    // adds u, v, w and p at the cell center of a fluid cell
+    auto add_cell = [&](double* sum, std::size_t i, std::size_t j, std::size_t k)
+    {
+        if (!cell_types(i, j, k).test(is_fluid))
+            return false;
+
+        sum[0] += (u_data(i, j, k) + u_data(i - 1, j, k)) / 2.;
+        sum[1] += (v_data(i, j, k) + v_data(i, j - 1, k)) / 2.;
+        sum[2] += (w_data(i, j, k) + w_data(i, j, k - 1)) / 2.;
+        sum[3] += p_data(i, j, k);
+
+        return true;
+    };
+
+    // calls f(i, j, k) for the interior cells of the partition in the
+    // plane of the given global cell, if any
+    auto for_plane = [&](std::size_t axis, std::size_t cell, auto const& f)
+    {
+        std::size_t const plane = local(axis, cell);
+
+        if (plane == 0)
+            return;
+
+        std::size_t begin[3] = {1, 1, 1};
+        std::size_t end[3] = {cells[0], cells[1], cells[2]};
+        begin[axis] = end[axis] = plane;
+
+        for (std::size_t k = begin[2]; k <= end[2]; ++k)
+            for (std::size_t j = begin[1]; j <= end[1]; ++j)
+                for (std::size_t i = begin[0]; i <= end[0]; ++i)
+                    f(i, j, k);
+    };
+
+    double* sum = sums.data();
+
+    for (auto const& m : monitors)
+    {
+        switch (m.type)
+        {
+            case monitor::probe:
+            {
+                std::size_t const i = local(0, m.cell[0]);
+                std::size_t const j = local(1, m.cell[1]);
+                std::size_t const k = local(2, m.cell[2]);
+
+                // only the owner contributes, a probe in an obstacle stays empty
+                if (i != 0 && j != 0 && k != 0 && add_cell(sum, i, j, k))
+                    sum[4] = 1;
+
+                break;
+            }
+
+            case monitor::plane_average:
+                for_plane(m.axis, m.cell[m.axis],
+                    [&](std::size_t i, std::size_t j, std::size_t k)
+                    {
+                        if (add_cell(sum, i, j, k))
+                            sum[4] += 1;
+                    });
+                break;
+
+            case monitor::kinetic_energy:
+                for (std::size_t k = 1; k <= cells[2]; ++k)
+                    for (std::size_t j = 1; j <= cells[1]; ++j)
+                        for (std::size_t i = 1; i <= cells[0]; ++i)
+                        {
+                            if (!cell_types(i, j, k).test(is_fluid))
+                                continue;
+
+                            double const u = (u_data(i, j, k) + u_data(i - 1, j, k)) / 2.;
+                            double const v = (v_data(i, j, k) + v_data(i, j - 1, k)) / 2.;
+                            double const w = (w_data(i, j, k) + w_data(i, j, k - 1)) / 2.;
+
+                            sum[0] += 0.5 * (u * u + v * v + w * w) * dx * dy * dz;
+                        }
+                break;
+
+            case monitor::pressure_drop:
+                for_plane(m.axis, m.cell[m.axis],
+                    [&](std::size_t i, std::size_t j, std::size_t k)
+                    {
+                        if (cell_types(i, j, k).test(is_fluid))
+                        {
+                            sum[0] += p_data(i, j, k);
+                            sum[1] += 1;
+                        }
+                    });
+                for_plane(m.axis, m.second,
+                    [&](std::size_t i, std::size_t j, std::size_t k)
+                    {
+                        if (cell_types(i, j, k).test(is_fluid))
+                        {
+                            sum[2] += p_data(i, j, k);
+                            sum[3] += 1;
+                        }
+                    });
+                break;
+        }
+
+        sum += m.num_sums();
+    }
+
+    return sums;
+}
+
+std::vector<double> writer::monitor_values(std::vector<monitor> const& monitors,
+    std::vector<double> const& sums)
+{
+    double const nan = std::numeric_limits<double>::quiet_NaN();
+
+    std::vector<double> values;
+    double const* sum = sums.data();
+
+    for (auto const& m : monitors)
+    {
+        switch (m.type)
+        {
+            case monitor::probe:
+            case monitor::plane_average:
+                for (std::size_t var = 0; var < 4; ++var)
+                    values.push_back(sum[4] > 0 ? sum[var] / sum[4] : nan);
+                break;
+
+            case monitor::kinetic_energy:
+                values.push_back(sum[0]);
+                break;
+
+            case monitor::pressure_drop:
+                values.push_back(sum[1] > 0 && sum[3] > 0 ? sum[0] / sum[1] - sum[2] / sum[3] : nan);
+                break;
+        }
+
+        sum += m.num_sums();
+    }
+
+    return values;
+}
+
+void writer::write_monitor_header(std::string const& filename,
+    std::vector<monitor> const& monitors, bool append)
+{
+    if (append)
+        return;
+
+    std::ofstream os(filename, std::ios::trunc);
+
+    os << "step,t";
+
+    for (auto const& m : monitors)
+        for (auto const& column : m.columns())
+            os << "," << column;
+
+    os << "\n";
+}
+
+void writer::append_monitor_values(std::string const& filename, std::size_t step,
+    double t, std::vector<double> const& values)
+{
+    std::ofstream os(filename, std::ios::app);
+
+    os << std::setprecision(std::numeric_limits<double>::digits10) << step << "," << t;
+
+    for (double value : values)
+        os << "," << value;
+
+    os << "\n";
+}
+
 }
 }
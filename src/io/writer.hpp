@@ -2,21 +2,141 @@
 #define NAST_HPX_IO_WRITER_HPP_
 
 #include "grid/partition_data.hpp"
+#include "monitor.hpp"
+#include "output_view.hpp"
 
 #include <bitset>
+#include <cstdint>
+#include <string>
+#include <vector>
 
 namespace nast_hpx { namespace io {
 
     typedef grid::partition_data<double> grid_type;
     typedef grid::partition_data<std::bitset<9> > type_grid;
 
+    /// First bytes of an aggregated field file.
+    char const field_file_magic[8] = {'N', 'A', 'S', 'T', 'F', 'L', 'D', '1'};
+
+    /// Header of an aggregated field file, one file per output step. It is
+    /// followed by one field_file_block per locality and the blocks at their
+    /// offsets. A block holds the interior cells of a partition, i fastest,
+    /// as double pressure, u, v, w (cell centered, 0 in obstacles) followed by
+    /// the uint16_t flags, padded to a multiple of 8 bytes.
+    struct field_file_header
+    {
+        char magic[8];
+
+        std::uint32_t num_blocks;
+        std::uint32_t i_max;
+        std::uint32_t j_max;
+        std::uint32_t k_max;
+        std::uint32_t cells_x;
+        std::uint32_t cells_y;
+        std::uint32_t cells_z;
+        std::uint32_t reserved;
+
+        std::uint64_t step;
+        double t;
+        double dx;
+        double dy;
+        double dz;
+
+        std::uint64_t block_size;
+    };
+
+    /// Position of a locality's block in an aggregated field file.
+    struct field_file_block
+    {
+        std::uint32_t idx;
+        std::uint32_t idy;
+        std::uint32_t idz;
+        std::uint32_t reserved;
+
+        std::uint64_t offset;
+    };
+
+    /// Samples of an output view taken from the interior of one partition,
+    /// first and last are the samples of the view along each axis.
+    struct view_piece
+    {
+        std::size_t first[3];
+        std::size_t last[3];
+
+        std::vector<double> pressure;
+        std::vector<std::int32_t> obstacle;
+        std::vector<double> velocity;
+    };
+
     struct writer
     {
         static void write_vtk(grid_type const& p_data, grid_type const& u_data,
             grid_type const& v_data, grid_type const& w_data, type_grid const& cell_types,
             std::size_t res_x, std::size_t res_y, std::size_t res_z, std::size_t i_max,
             std::size_t j_max, std::size_t k_max, double dx, double dy, double dz, std::size_t step,
-            std::size_t loc, std::size_t idx, std::size_t idy, std::size_t idz);
+            std::size_t loc, std::size_t idx, std::size_t idy, std::size_t idz,
+            bool binary, bool float64, int compression_level);
+
+        /// size in bytes of the block of a partition with the given interior
+        static std::uint64_t block_size(std::size_t cells_x, std::size_t cells_y, std::size_t cells_z);
+
+        /// packs the interior of a partition into a block of an aggregated field file
+        static std::vector<char> pack_block(grid_type const& p_data, grid_type const& u_data,
+            grid_type const& v_data, grid_type const& w_data, type_grid const& cell_types);
+
+        /// interior cells of a field, i fastest, averaged to the cell centers
+        /// along the staggered axis (-1 for the pressure), 0 in obstacles
+        static std::vector<double> cell_centered(grid_type const& data,
+            type_grid const& cell_types, int staggered_axis);
+
+        /// flags of the interior cells, i fastest
+        static std::vector<std::uint16_t> cell_flags(type_grid const& cell_types);
+
+        /// writes the blocks of the consecutive localities starting at
+        /// first_loc into the field file of the given step, the root locality
+        /// also writes the header
+        static void write_aggregated(std::vector<std::vector<char> > const& blocks,
+            std::size_t first_loc, std::size_t res_x, std::size_t res_y, std::size_t res_z,
+            std::size_t i_max, std::size_t j_max, std::size_t k_max,
+            std::size_t cells_x, std::size_t cells_y, std::size_t cells_z,
+            double dx, double dy, double dz, double t, std::size_t step);
+
+        /// finds the samples of the view in the given partition, returns
+        /// false if it does not intersect the view
+        static bool view_range(output_view const& view, std::size_t cells_x, std::size_t cells_y,
+            std::size_t cells_z, std::size_t idx, std::size_t idy, std::size_t idz,
+            std::size_t first[3], std::size_t last[3]);
+
+        /// copies the samples of the view out of a partition, the piece is
+        /// empty if the partition does not intersect the view
+        static view_piece sample_view(output_view const& view, grid_type const& p_data,
+            grid_type const& u_data, grid_type const& v_data, grid_type const& w_data,
+            type_grid const& cell_types, std::size_t idx, std::size_t idy, std::size_t idz);
+
+        /// writes the piece of a locality, the root also writes the pvtr
+        /// referencing the pieces of all intersecting localities
+        static void write_view(output_view const& view, view_piece const& piece, std::size_t count,
+            std::size_t loc, std::size_t res_x, std::size_t res_y, std::size_t res_z,
+            std::size_t cells_x, std::size_t cells_y, std::size_t cells_z,
+            double dx, double dy, double dz, bool float64, int compression_level);
+
+        /// partial sums of all monitors over the interior of a partition
+        static std::vector<double> sum_monitors(std::vector<monitor> const& monitors,
+            grid_type const& p_data, grid_type const& u_data, grid_type const& v_data,
+            grid_type const& w_data, type_grid const& cell_types,
+            std::size_t idx, std::size_t idy, std::size_t idz, double dx, double dy, double dz);
+
+        /// turns the sums of all localities into the values of the columns
+        static std::vector<double> monitor_values(std::vector<monitor> const& monitors,
+            std::vector<double> const& sums);
+
+        /// starts the monitor file with the column names, or appends to it
+        /// when a run is continued
+        static void write_monitor_header(std::string const& filename,
+            std::vector<monitor> const& monitors, bool append);
+
+        static void append_monitor_values(std::string const& filename, std::size_t step,
+            double t, std::vector<double> const& values);
     };
 
 }
@@ -1,19 +1,25 @@
 #include "io/config.hpp"
+#include "io/partition_stats.hpp"
 #include "stepper/stepper.hpp"
+#include "util/halo_stats.hpp"
+#include "util/phase_timer.hpp"
 
 #include <iostream>
 #include <chrono>
 #include <hpx/hpx_init.hpp>
 #include <hpx/hpx.hpp>
 
+char const* partition_stats_basename = "/nast_hpx/gather/partition_stats";
+
 int hpx_main(boost::program_options::variables_map& vm)
 {
     const auto cfg_path = vm["cfg"].as<std::string>();
     const auto grid_path = vm["grid"].as<std::string>();
+    const auto restart_dir = vm["restart"].as<std::string>();
     const auto iterations = vm["iterations"].as<std::size_t>();
     const auto timesteps = vm["timesteps"].as<std::size_t>();
 
-    nast_hpx::io::config cfg = nast_hpx::io::config::read_config_from_file(cfg_path.c_str(), grid_path.c_str(), hpx::get_locality_id(), hpx::get_initial_num_localities());
+    nast_hpx::io::config cfg = nast_hpx::io::config::read_config_from_file(cfg_path.c_str(), grid_path.c_str(), restart_dir.c_str(), hpx::get_locality_id(), hpx::get_initial_num_localities());
     cfg.max_timesteps = timesteps;
     cfg.verbose = vm.count("verbose") ? true : false;
 
@@ -36,6 +42,9 @@ int hpx_main(boost::program_options::variables_map& vm)
         else
             std::cout << "for " << timesteps << " iterations"
                 << " and " << iterations << " runs!" << std::endl;
+
+        if (!cfg.restart_file.empty())
+            std::cout << "Restarting from " << cfg.restart_file << std::endl;
     }
 
     cfg.idx = (rank % (cfg.num_localities_x * cfg.num_localities_y)) % cfg.num_localities_x;
@@ -47,6 +56,20 @@ int hpx_main(boost::program_options::variables_map& vm)
     cfg.num_localities_z = cfg.num_localities_z;
     cfg.num_localities = cfg.num_localities;
 
+    // the decomposition is known from the flags, before anything is allocated
+    nast_hpx::io::partition_stats stats = nast_hpx::io::partition_stats::compute(cfg);
+
+    if (rank == 0)
+        nast_hpx::io::partition_stats::report(std::cout,
+            hpx::lcos::gather_here(partition_stats_basename, hpx::make_ready_future(stats),
+                cfg.num_localities).get(),
+            cfg, cfg.verbose || vm.count("dry-run"));
+    else
+        hpx::lcos::gather_there(partition_stats_basename, hpx::make_ready_future(stats)).get();
+
+    if (vm.count("dry-run"))
+        return hpx::finalize();
+
     double avgtime = 0.;
     double maxtime = 0.;
     double mintime = 365. * 24. * 3600.;
@@ -111,16 +134,24 @@ int main(int argc, char* argv[])
     desc_commandline.add_options()
     ("cfg", value<std::string>()->required(),
          "path to config xml file")
-    ("grid", value<std::string>()->required(),
-         "path to grid file")
+    ("grid", value<std::string>()->default_value(""),
+         "path to grid file (default: use the Geometry of the config)")
+    ("restart", value<std::string>()->default_value(""),
+         "continue from the latest checkpoint in the given directory")
     ("iterations", value<std::size_t>()->default_value(1),
          "Number of runs of the simulation")
     ("timesteps", value<std::size_t>()->default_value(0),
          "Number of timesteps per run (0 = use t_end)")
-     ( "verbose", "Verbose output");
+     ( "verbose", "Verbose output")
+     ( "dry-run", "Only report the decomposition, without running the simulation");
 
     std::vector<std::string> cfg;
     cfg.push_back("hpx.run_hpx_main!=1");
 
+    // the phase timings and halo statistics can be queried with
+    // --hpx:print-counter
+    hpx::register_startup_function(&nast_hpx::util::phase_timer::register_counters);
+    hpx::register_startup_function(&nast_hpx::util::halo_stats::register_counters);
+
     return hpx::init(desc_commandline, argc, argv, cfg);
 }
@@ -0,0 +1,559 @@
+#include "io/config.hpp"
+#include "io/geometry.hpp"
+#include "grid/pack_buffer.hpp"
+#include "grid/partition_data.hpp"
+#include "grid/stencils.hpp"
+#include "grid/unpack_buffer.hpp"
+#include "util/triple.hpp"
+
+#include <hpx/hpx_init.hpp>
+#include <hpx/hpx.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using nast_hpx::grid::partition_data;
+using nast_hpx::triple;
+
+namespace grid = nast_hpx::grid;
+namespace io = nast_hpx::io;
+
+namespace {
+
+    typedef nast_hpx::index cell_index;
+    typedef hpx::serialization::serialize_buffer<double> buffer_type;
+    typedef partition_data<std::bitset<9> > flag_grid;
+
+    /// Fields and cell lists of a partition, set up like partition_server
+    /// does from the flags of its grid.
+    struct bench_partition
+    {
+        partition_data<double> u, v, w, f, g, h, p, rhs;
+        flag_grid cell_types;
+
+        std::vector<cell_index> fluid_cells;
+        std::vector<cell_index> obstacle_cells;
+
+        double obstacle_fraction;
+    };
+
+    /// The partition is the center one of a 3x3x3 domain filled with random
+    /// spheres of radius 0.1 partition lengths, so it has no domain boundary.
+    /// For independently placed spheres the obstacle fraction is
+    /// 1 - exp(-n V / V_domain), which gives their number n.
+    bench_partition make_partition(std::size_t size, double fraction, unsigned seed)
+    {
+        io::geometry geo;
+        geo.i_max = geo.j_max = geo.k_max = 3 * size;
+        geo.x_length = geo.y_length = geo.z_length = 3.;
+
+        double const radius = 0.1;
+        double const volume = 4. / 3. * M_PI * radius * radius * radius;
+        std::size_t const count = fraction > 0
+            ? static_cast<std::size_t>(std::ceil(-std::log(1. - fraction) * 27. / volume)) : 0;
+
+        std::mt19937 gen(seed);
+        std::uniform_real_distribution<double> position(0., 3.);
+
+        for (std::size_t n = 0; n < count; ++n)
+        {
+            io::shape s;
+            s.type = io::shape::sphere;
+            s.min = triple<double>(position(gen), position(gen), position(gen));
+            s.max = s.min;
+            s.radius = radius;
+            s.axis = 0;
+
+            geo.obstacles.push_back(s);
+        }
+
+        io::config cfg;
+        cfg.cells_x_per_partition = cfg.cells_y_per_partition = cfg.cells_z_per_partition = size;
+
+        std::size_t const num_fluid = geo.rasterize(cfg, 1, 1, 1);
+
+        bench_partition part;
+        part.obstacle_fraction = 1. - static_cast<double>(num_fluid) / (size * size * size);
+
+        std::size_t const res = size + 2;
+
+        for (auto* field : {&part.u, &part.v, &part.w, &part.f, &part.g, &part.h, &part.p, &part.rhs})
+            field->resize(res, res, res, 0);
+
+        part.cell_types.resize(res, res, res);
+
+        for (std::size_t k = 1; k < res - 1; ++k)
+            for (std::size_t j = 1; j < res - 1; ++j)
+                for (std::size_t i = 1; i < res - 1; ++i)
+                {
+                    part.cell_types(i, j, k) = cfg.flag_grid[k * res * res + j * res + i];
+
+                    if (part.cell_types(i, j, k)[is_fluid])
+                        part.fluid_cells.emplace_back(i, j, k);
+                    else if ((part.cell_types(i, j, k)[is_obstacle]
+                                && !part.cell_types(i, j, k)[is_boundary]
+                                && part.cell_types(i, j, k).count() > 1)
+                            || part.cell_types(i, j, k).count() > 2)
+                        part.obstacle_cells.emplace_back(i, j, k);
+                }
+
+        // smooth fields keep the values away from denormals
+        for (std::size_t k = 0; k < res; ++k)
+            for (std::size_t j = 0; j < res; ++j)
+                for (std::size_t i = 0; i < res; ++i)
+                {
+                    double const x = static_cast<double>(i + j + k) / res;
+
+                    part.u(i, j, k) = 1. + 0.1 * std::sin(x);
+                    part.v(i, j, k) = 0.1 * std::cos(x);
+                    part.w(i, j, k) = 0.1 * std::sin(2 * x);
+                    part.p(i, j, k) = x;
+                    part.rhs(i, j, k) = 0.01;
+                }
+
+        return part;
+    }
+
+    /// Best time of a sweep over the cells, split into chunks run as tasks
+    /// like in the solver. The results of the chunks are reduced by combine.
+    template <typename Kernel, typename Combine>
+    double time_sweep(std::vector<cell_index>& cells, std::size_t chunks, std::size_t repetitions,
+        Kernel kernel, Combine combine)
+    {
+        typedef std::vector<cell_index>::iterator iterator;
+        typedef decltype(kernel(cells.begin(), cells.end())) result_type;
+
+        std::size_t const stride = std::max<std::size_t>(1, (cells.size() + chunks - 1) / chunks);
+        double best = std::numeric_limits<double>::max();
+
+        for (std::size_t rep = 0; rep < repetitions; ++rep)
+        {
+            hpx::util::high_resolution_timer timer;
+
+            std::vector<hpx::future<result_type> > results;
+
+            for (std::size_t first = 0; first < cells.size(); first += stride)
+            {
+                iterator const begin = cells.begin() + first;
+                iterator const end = cells.begin() + std::min(first + stride, cells.size());
+
+                results.push_back(hpx::async(kernel, begin, end));
+            }
+
+            combine(results);
+
+            best = std::min(best, timer.elapsed());
+        }
+
+        return best;
+    }
+
+    template <typename F>
+    double time_call(std::size_t repetitions, F f)
+    {
+        double best = std::numeric_limits<double>::max();
+
+        for (std::size_t rep = 0; rep < repetitions; ++rep)
+        {
+            hpx::util::high_resolution_timer timer;
+            f();
+            best = std::min(best, timer.elapsed());
+        }
+
+        return best;
+    }
+
+    void wait(std::vector<hpx::future<void> >& results)
+    {
+        hpx::wait_all(results);
+    }
+
+    /// attained bandwidth of the STREAM triad a = b + s * c in GB/s, with
+    /// the same chunking as the kernels
+    double stream_triad(std::size_t n, std::size_t chunks, std::size_t repetitions)
+    {
+        std::vector<double> a(n, 0.), b(n, 1.), c(n, 2.);
+        std::size_t const stride = (n + chunks - 1) / chunks;
+
+        double const seconds = time_call(repetitions,
+            [&]()
+            {
+                std::vector<hpx::future<void> > results;
+
+                for (std::size_t first = 0; first < n; first += stride)
+                    results.push_back(hpx::async(
+                        [&, first]()
+                        {
+                            std::size_t const last = std::min(first + stride, n);
+
+                            for (std::size_t i = first; i < last; ++i)
+                                a[i] = b[i] + 3. * c[i];
+                        }
+                    ));
+
+                hpx::wait_all(results);
+            }
+        );
+
+        return 3. * sizeof(double) * n / seconds * 1e-9;
+    }
+
+    struct report
+    {
+        std::size_t size;
+        double fraction;
+        double stream;
+        bool csv;
+
+        /// bytes is the compulsory memory traffic per cell
+        void operator()(std::string const& kernel, std::size_t cells, double seconds,
+            double bytes) const
+        {
+            double const cells_per_s = cells > 0 ? cells / seconds : 0.;
+            double const gb_per_s = cells_per_s * bytes * 1e-9;
+
+            if (csv)
+            {
+                std::cout << size << "," << fraction << "," << kernel << "," << cells << ","
+                    << (cells > 0 ? seconds : 0.) << "," << cells_per_s * 1e-6 << ","
+                    << gb_per_s << "," << gb_per_s / stream << std::endl;
+                return;
+            }
+
+            char line[160];
+            std::snprintf(line, sizeof(line), "%-24s %10zu %12.1f %10.1f %8.2f %7.1f%%",
+                kernel.c_str(), cells, cells > 0 ? seconds * 1e6 : 0., cells_per_s * 1e-6,
+                gb_per_s, 100. * gb_per_s / stream);
+
+            std::cout << line << std::endl;
+        }
+    };
+
+    char const* direction_name(grid::direction dir)
+    {
+        static char const* const names[grid::NUM_DIRECTIONS] = {
+            "left", "bottom", "back", "back_left", "bottom_right", "back_bottom",
+            "front_top", "top_left", "front_right", "front", "top", "right"
+        };
+
+        return names[dir];
+    }
+
+    /// packing reads the face and writes the buffer, unpacking the reverse
+    template <grid::direction dir>
+    void bench_halo(bench_partition& part, std::size_t repetitions, report const& print)
+    {
+        buffer_type buffer;
+        grid::pack_buffer<dir>::call(part.p, buffer);
+
+        std::size_t const cells = buffer.size();
+        double const bytes = 2. * sizeof(double);
+
+        print(std::string("pack_") + direction_name(dir), cells,
+            time_call(repetitions,
+                [&]() { grid::pack_buffer<dir>::call(part.p, buffer); }),
+            bytes);
+
+        print(std::string("unpack_") + direction_name(dir), cells,
+            time_call(repetitions,
+                [&]() { grid::unpack_buffer<dir>::call(part.p, buffer); }),
+            bytes);
+    }
+
+    void bench_kernels(bench_partition& part, std::size_t chunks, std::size_t repetitions,
+        report const& print)
+    {
+        typedef std::vector<cell_index>::iterator iterator;
+
+        std::size_t const size = part.p.size_x_ - 2;
+        double const d = 1. / size;
+        double const d_sq = d * d;
+        double const dt = 1e-4;
+
+        nast_hpx::util::cancellation_token token;
+        grid::boundary_condition bnd_condition;
+
+        double const index_bytes = sizeof(cell_index);
+        double const flag_bytes = sizeof(std::bitset<9>);
+        double const value = sizeof(double);
+
+        print("set_velocity_obstacle", part.obstacle_cells.size(),
+            time_sweep(part.obstacle_cells, chunks, repetitions,
+                [&](iterator begin, iterator end)
+                {
+                    grid::stencils<grid::STENCIL_SET_VELOCITY_OBSTACLE>::call(
+                        part.u, part.v, part.w, part.cell_types, begin, end, bnd_condition);
+                },
+                wait),
+            index_bytes + flag_bytes + 6 * value);
+
+        // the obstacle cells are spread over the chunks like the fluid cells
+        std::size_t const obstacle_stride = std::max<std::size_t>(1,
+            (part.obstacle_cells.size() + chunks - 1) / chunks);
+        std::size_t const fluid_stride = std::max<std::size_t>(1,
+            (part.fluid_cells.size() + chunks - 1) / chunks);
+
+        print("compute_fg", part.fluid_cells.size(),
+            time_sweep(part.fluid_cells, chunks, repetitions,
+                [&](iterator begin, iterator end)
+                {
+                    std::size_t const chunk = (begin - part.fluid_cells.begin()) / fluid_stride;
+                    std::size_t const first =
+                        std::min(chunk * obstacle_stride, part.obstacle_cells.size());
+                    std::size_t const last =
+                        std::min(first + obstacle_stride, part.obstacle_cells.size());
+
+                    grid::stencils<grid::STENCIL_COMPUTE_FG>::call(
+                        part.f, part.g, part.h, part.u, part.v, part.w, part.cell_types,
+                        part.obstacle_cells.begin() + first, part.obstacle_cells.begin() + last,
+                        begin, end, 100., 0., 0., 0., d, d, d, d_sq, d_sq, d_sq, dt, 0.9);
+                },
+                wait),
+            index_bytes + flag_bytes + 6 * value);
+
+        print("compute_rhs", part.fluid_cells.size(),
+            time_sweep(part.fluid_cells, chunks, repetitions,
+                [&](iterator begin, iterator end)
+                {
+                    grid::stencils<grid::STENCIL_COMPUTE_RHS>::call(
+                        part.rhs, part.f, part.g, part.h, begin, end, d, d, d, dt);
+                },
+                wait),
+            index_bytes + 4 * value);
+
+        print("set_p_obstacle", part.obstacle_cells.size(),
+            time_sweep(part.obstacle_cells, chunks, repetitions,
+                [&](iterator begin, iterator end)
+                {
+                    grid::stencils<grid::STENCIL_SET_P_OBSTACLE>::call(
+                        part.p, part.cell_types, begin, end, token);
+                },
+                wait),
+            index_bytes + flag_bytes + 2 * value);
+
+        print("jacobi", part.fluid_cells.size(),
+            time_sweep(part.fluid_cells, chunks, repetitions,
+                [&](iterator begin, iterator end)
+                {
+                    grid::stencils<grid::STENCIL_JACOBI>::call(
+                        part.p, part.rhs, begin, end, d_sq, d_sq, d_sq, token);
+                },
+                wait),
+            index_bytes + 3 * value);
+
+        // second order, the history of two solves is shifted in the same pass
+        std::vector<double> history_1(part.fluid_cells.size(), 0.5);
+        std::vector<double> history_2(part.fluid_cells.size(), 0.25);
+
+        print("extrapolate_p", part.fluid_cells.size(),
+            time_sweep(part.fluid_cells, chunks, repetitions,
+                [&](iterator begin, iterator end)
+                {
+                    std::size_t const offset = begin - part.fluid_cells.begin();
+
+                    grid::stencils<grid::STENCIL_EXTRAPOLATE_P>::call(
+                        part.p, history_1.data() + offset, history_2.data() + offset,
+                        begin, end, 3., -3., 1.);
+                },
+                wait),
+            index_bytes + 6 * value);
+
+        // the two passes of a Chebyshev iteration, F and G stand in for the
+        // Jacobi result and the previous P
+        print("jacobi_sweep", part.fluid_cells.size(),
+            time_sweep(part.fluid_cells, chunks, repetitions,
+                [&](iterator begin, iterator end)
+                {
+                    grid::stencils<grid::STENCIL_JACOBI_SWEEP>::call(
+                        part.f, part.p, part.rhs, begin, end, d_sq, d_sq, d_sq, token);
+                },
+                wait),
+            index_bytes + 3 * value);
+
+        print("chebyshev", part.fluid_cells.size(),
+            time_sweep(part.fluid_cells, chunks, repetitions,
+                [&](iterator begin, iterator end)
+                {
+                    grid::stencils<grid::STENCIL_CHEBYSHEV>::call(
+                        part.p, part.g, part.f, begin, end, 1.5, 0., token);
+                },
+                wait),
+            index_bytes + 5 * value);
+
+        // SOR and the copy parallelize over all cells themselves
+        print("sor", part.fluid_cells.size(),
+            time_call(repetitions,
+                [&]()
+                {
+                    grid::stencils<grid::STENCIL_SOR>::call(
+                        part.p, part.rhs, part.fluid_cells, -0.7, 1.7 / 6. * d_sq,
+                        d_sq, d_sq, d_sq, token);
+                }),
+            index_bytes + 3 * value);
+
+        print("copy", part.fluid_cells.size(),
+            time_call(repetitions,
+                [&]()
+                {
+                    grid::stencils<grid::STENCIL_NONE>::call(part.f, part.p, part.fluid_cells);
+                }),
+            index_bytes + 2 * value);
+
+        // the reductions include combining the results of the chunks
+        double residual = 0;
+
+        print("residual_reduction", part.fluid_cells.size(),
+            time_sweep(part.fluid_cells, chunks, repetitions,
+                [&](iterator begin, iterator end)
+                {
+                    return grid::stencils<grid::STENCIL_COMPUTE_RESIDUAL>::call(
+                        part.p, part.rhs, begin, end, d_sq, d_sq, d_sq, token);
+                },
+                [&](std::vector<hpx::future<double> >& results)
+                {
+                    residual = 0;
+                    for (auto& r : results)
+                        residual += r.get();
+                }),
+            index_bytes + 2 * value);
+
+        triple<double> max_uvw(0);
+
+        print("update_velocity_max", part.fluid_cells.size(),
+            time_sweep(part.fluid_cells, chunks, repetitions,
+                [&](iterator begin, iterator end)
+                {
+                    return grid::stencils<grid::STENCIL_UPDATE_VELOCITY>::call(
+                        part.u, part.v, part.w, part.f, part.g, part.h, part.p,
+                        part.cell_types, begin, end, dt, size, size, size);
+                },
+                [&](std::vector<hpx::future<triple<double> > >& results)
+                {
+                    max_uvw = triple<double>(0);
+                    for (auto& r : results)
+                    {
+                        triple<double> const local = r.get();
+                        max_uvw.x = std::max(max_uvw.x, local.x);
+                        max_uvw.y = std::max(max_uvw.y, local.y);
+                        max_uvw.z = std::max(max_uvw.z, local.z);
+                    }
+                }),
+            index_bytes + flag_bytes + 7 * value);
+
+        // keeps the reductions from being optimized away
+        if (!std::isfinite(residual + max_uvw.x + max_uvw.y + max_uvw.z))
+            std::cerr << "Warning: the fields diverged during the benchmark" << std::endl;
+
+        bench_halo<grid::LEFT>(part, repetitions, print);
+        bench_halo<grid::RIGHT>(part, repetitions, print);
+        bench_halo<grid::BOTTOM>(part, repetitions, print);
+        bench_halo<grid::TOP>(part, repetitions, print);
+        bench_halo<grid::FRONT>(part, repetitions, print);
+        bench_halo<grid::BACK>(part, repetitions, print);
+        bench_halo<grid::BACK_LEFT>(part, repetitions, print);
+        bench_halo<grid::FRONT_RIGHT>(part, repetitions, print);
+        bench_halo<grid::BOTTOM_RIGHT>(part, repetitions, print);
+        bench_halo<grid::TOP_LEFT>(part, repetitions, print);
+        bench_halo<grid::BACK_BOTTOM>(part, repetitions, print);
+        bench_halo<grid::FRONT_TOP>(part, repetitions, print);
+    }
+
+    template <typename T>
+    std::vector<T> parse_list(std::string const& list)
+    {
+        std::vector<T> values;
+        std::istringstream is(list);
+        std::string item;
+
+        while (std::getline(is, item, ','))
+            values.push_back(static_cast<T>(std::stod(item)));
+
+        return values;
+    }
+}
+
+/// Times the stencils, the halo packing and the reductions of the solver in
+/// isolation on synthetic partitions of the given sizes and obstacle
+/// fractions. The bandwidth of each kernel is derived from its compulsory
+/// memory traffic per cell and compared to the STREAM triad.
+int hpx_main(boost::program_options::variables_map& vm)
+{
+    const auto sizes = parse_list<std::size_t>(vm["sizes"].as<std::string>());
+    const auto fractions = parse_list<double>(vm["obstacles"].as<std::string>());
+    const auto repetitions = vm["repetitions"].as<std::size_t>();
+    const auto stream_size = vm["stream-size"].as<std::size_t>();
+    const auto seed = vm["seed"].as<unsigned>();
+    const bool csv = vm.count("csv") > 0;
+
+    std::size_t chunks = vm["chunks"].as<std::size_t>();
+    if (chunks == 0)
+        chunks = 4 * hpx::get_os_thread_count();
+
+    double const stream = stream_triad(stream_size, chunks, repetitions);
+
+    if (csv)
+        std::cout << "size,obstacle_fraction,kernel,cells,seconds,mcells_per_s,gb_per_s,stream_fraction"
+            << std::endl;
+    else
+        std::cout << "Threads: " << hpx::get_os_thread_count() << ", chunks: " << chunks
+            << ", STREAM triad: " << stream << " GB/s" << std::endl;
+
+    for (std::size_t size : sizes)
+    {
+        for (double fraction : fractions)
+        {
+            if (size < 2 || fraction < 0 || fraction >= 1)
+            {
+                std::cerr << "Error: sizes must be at least 2 and obstacle fractions in [0, 1)!"
+                    << std::endl;
+                return hpx::finalize();
+            }
+
+            bench_partition part = make_partition(size, fraction, seed);
+
+            if (!csv)
+                std::cout << "\nPartition " << size << "^3, obstacle fraction " << fraction
+                    << " (rasterized " << part.obstacle_fraction << "), "
+                    << part.fluid_cells.size() << " fluid cells, "
+                    << part.obstacle_cells.size() << " obstacle cells\n"
+                    << "kernel                        cells    time [us]   Mcells/s     GB/s  STREAM"
+                    << std::endl;
+
+            bench_kernels(part, chunks, repetitions,
+                report{size, part.obstacle_fraction, stream, csv});
+        }
+    }
+
+    return hpx::finalize();
+}
+
+int main(int argc, char* argv[])
+{
+    using namespace boost::program_options;
+
+    options_description desc_commandline;
+
+    desc_commandline.add_options()
+    ("sizes", value<std::string>()->default_value("32,64,128"),
+         "comma separated cells per axis of the partitions")
+    ("obstacles", value<std::string>()->default_value("0,0.1,0.3"),
+         "comma separated obstacle fractions of the partitions")
+    ("repetitions", value<std::size_t>()->default_value(20),
+         "runs of every kernel, the best one is reported")
+    ("chunks", value<std::size_t>()->default_value(0),
+         "tasks per sweep (default: 4 per thread, like the solver)")
+    ("stream-size", value<std::size_t>()->default_value(1 << 24),
+         "elements of the STREAM triad arrays")
+    ("seed", value<unsigned>()->default_value(42),
+         "seed of the random obstacles")
+    ("csv", "print csv instead of a table");
+
+    return hpx::init(desc_commandline, argc, argv);
+}
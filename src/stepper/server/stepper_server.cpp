@@ -1,7 +1,13 @@
 #include "stepper_server.hpp"
 
+#include "io/checkpoint.hpp"
+#include "io/telemetry.hpp"
+#include "util/halo_stats.hpp"
+#include "util/hw_counters.hpp"
+#include "util/trace.hpp"
 #include "util/triple.hpp"
 
+#include <algorithm>
 #include <chrono>
 
 typedef nast_hpx::stepper::server::stepper_server stepper_component;
@@ -17,6 +23,8 @@ HPX_REGISTER_ACTION(nast_hpx::stepper::server::stepper_server::run_action,
 
 typedef nast_hpx::triple<double> vec3;
 HPX_REGISTER_GATHER(vec3, stepper_server_velocity_gather);
+HPX_REGISTER_GATHER(std::size_t, stepper_server_fluid_cells_gather);
+HPX_REGISTER_GATHER(bool, stepper_server_checkpoint_gather);
 
 namespace nast_hpx { namespace stepper { namespace server {
 
@@ -37,13 +45,63 @@ void stepper_server::setup(io::config const& cfg)
     tau = cfg.tau;
     t_end = cfg.t_end;
     init_dt = cfg.initial_dt;
+    dt_lookahead = cfg.dt_lookahead;
+    chained_steps = cfg.chained_steps;
+    verbose = cfg.verbose;
+    halo_summary = cfg.halo_summary;
+    adaptive_tau = cfg.adaptive_tau;
+
+    checkpoint_interval = cfg.checkpoint_interval;
+    checkpoint_walltime = cfg.checkpoint_walltime;
+    checkpoint_dir = cfg.checkpoint_dir;
+    restart_file = cfg.restart_file;
+
+    // a restart continues from the tau the run had reached, the throughput
+    // of the windows before it is not comparable and is measured anew
+    if (adaptive_tau)
+    {
+        double initial_tau = cfg.tau;
 
+        if (!restart_file.empty() && io::checkpoint::read_tau(restart_file, initial_tau)
+                && verbose && rank == 0)
+            std::cout << "Adaptive tau restarts from " << initial_tau << std::endl;
 
+        tau_control = util::tau_controller(initial_tau, cfg.tau_min, cfg.tau_max,
+            cfg.tau_window, cfg.tau_factor, verbose && rank == 0);
+    }
 
     max_timesteps = cfg.max_timesteps;
     step = 0;
 
-    part = grid::partition(hpx::find_here(), cfg);
+    // a restart continues the step numbering of the checkpoint
+    if (!restart_file.empty())
+        step = io::checkpoint::read_header(restart_file).stepper_step;
+
+    last_checkpoint_step = step;
+
+    // every locality only loaded its own part of the grid, so the residual
+    // normalization on the root needs the fluid cells of all partitions
+    io::config part_cfg(cfg);
+
+    if (rank == 0)
+    {
+        std::vector<std::size_t> fluid_cells =
+            hpx::lcos::gather_here(fluid_cells_basename,
+                hpx::make_ready_future<std::size_t>(cfg.num_local_fluid_cells),
+                num_localities).get();
+
+        part_cfg.num_fluid_cells = 0;
+        for (std::size_t cells : fluid_cells)
+            part_cfg.num_fluid_cells += cells;
+
+        if (verbose)
+            std::cout << "Fluid cells in domain: " << part_cfg.num_fluid_cells << std::endl;
+    }
+    else
+        hpx::lcos::gather_there(fluid_cells_basename,
+            hpx::make_ready_future<std::size_t>(cfg.num_local_fluid_cells)).get();
+
+    part = grid::partition(hpx::find_here(), part_cfg);
 
     std::vector<hpx::future<hpx::id_type > > steps =
         hpx::find_all_from_basename(stepper_basename, num_localities);
@@ -58,77 +116,298 @@ void stepper_server::run()
 {
     part.init_sync();
 
-    double dt = init_dt;
+    t = 0;
+    dt = init_dt;
+
+    if (!restart_file.empty())
+    {
+        io::checkpoint_header header = io::checkpoint::read_header(restart_file);
+
+        t = header.t;
+        dt = header.dt;
+    }
 
-    std::size_t local_step = 0;
+    local_step = 0;
+    pending_dt = step;
+    finished = false;
+    last_checkpoint = std::chrono::steady_clock::now();
 
-    for (double t = 0;; ++step, ++local_step)
+    // the time loop is a chain of continuations, this thread only suspends
+    // once every chained_steps steps to bound the length of the chain
+    while (!finished)
+        advance(chained_steps).get();
+
+    // wait for the reductions still in flight, leaving the buffer empty
+    for (; pending_dt < step; ++pending_dt)
     {
-        if (max_timesteps > 0 && local_step >= max_timesteps)
-            break;
+        dt_buffer.receive(pending_dt).get();
+        checkpoint_buffer.receive(pending_dt).get();
+    }
+
+    // the I/O pool and the residual reductions may still record events
+    part.flush_output().get();
+
+    io::telemetry::flush();
+    util::trace::write();
 
-        hpx::future<triple<double> > local_max_velocity =
-           part.do_timestep(dt);
+    if (util::hw_counters::enabled())
+        util::hw_counters::report(std::cout, rank);
 
-        // if this is the root locality gather all remote residuals and sum up
-        if (hpx::get_locality_id() == 0)
+    if (halo_summary)
+        util::halo_stats::report(std::cout, rank);
+
+    if (adaptive_tau && verbose && rank == 0)
+        std::cout << "Final tau: " << tau_control.tau() << std::endl;
+}
+
+hpx::future<void> stepper_server::advance(std::size_t remaining)
+{
+    if (remaining == 0)
+        return hpx::make_ready_future();
+
+    if (max_timesteps > 0 && local_step >= max_timesteps)
+    {
+        finished = true;
+        return hpx::make_ready_future();
+    }
+
+    hpx::shared_future<triple<double> > local_max_velocity =
+       part.do_timestep(dt);
+
+    reduce_max_velocity(local_max_velocity, step);
+
+    if (t >= t_end)
+    {
+        ++step;
+        finished = true;
+        return hpx::make_ready_future();
+    }
+
+    std::size_t const current_step = step;
+    bool const first_step = (local_step == 0);
+
+    t += dt;
+    ++step;
+    ++local_step;
+
+    hpx::future<double> next_dt;
+
+    if (!dt_lookahead)
+        next_dt = dt_buffer.receive(current_step);
+    else if (first_step)
+        next_dt = local_max_velocity.then(
+            [this](hpx::shared_future<triple<double> >)
+            {
+                return dt;
+            }
+        );
+    else
+        // step n + 1 runs with the dt reduced after step n - 1, so only
+        // the local part of step n has to be done before it can start
+        next_dt = hpx::dataflow(
+            hpx::util::unwrapping(
+                [](triple<double>, double lagged_dt)
+                {
+                    return lagged_dt;
+                }
+            )
+            , local_max_velocity
+            , dt_buffer.receive(current_step - 1)
+        );
+
+    return next_dt.then(
+        [this, remaining, current_step, first_step](hpx::future<double> f)
+        -> hpx::future<void>
         {
-            hpx::future<std::vector<triple<double> > >
-            max_velocities =
-                hpx::lcos::gather_here(velocity_basename,
-                                        std::move(local_max_velocity),
-                                        num_localities, step);
-
-            max_velocities.then(
-                hpx::util::unwrapping(
-                    [=, &t](std::vector<triple<double> > local_max_uvws)
+            double const new_dt = f.get();
+            bool checkpoint = false;
+
+            // the flag is stored before the dt it comes with, so it is ready
+            if (!dt_lookahead)
+            {
+                pending_dt = current_step + 1;
+                checkpoint = checkpoint_buffer.receive(current_step).get();
+            }
+            else if (!first_step)
+            {
+                pending_dt = current_step;
+                checkpoint = checkpoint_buffer.receive(current_step - 1).get();
+
+                // new_dt is the bound for the step that just ran with dt
+                if (verbose && rank == 0 && dt > new_dt)
+                    std::cout << "Warning: step " << current_step
+                        << " ran with dt = " << dt << " above the bound "
+                        << new_dt << std::endl;
+            }
+
+            dt = new_dt;
+
+            // no step after current_step has been issued yet, so the
+            // partitions are in a consistent state until this is done
+            if (checkpoint)
+                return write_checkpoint().then(
+                    [this, remaining](hpx::future<void> written)
+                    {
+                        written.get();
+                        return advance(remaining - 1);
+                    }
+                );
+
+            return advance(remaining - 1);
+        }
+    );
+}
+
+hpx::future<void> stepper_server::write_checkpoint()
+{
+    std::size_t const checkpoint_step = step;
+
+    double checkpoint_tau = tau;
+
+    if (adaptive_tau)
+    {
+        std::lock_guard<std::mutex> l(tau_mtx);
+        checkpoint_tau = tau_control.tau();
+    }
+
+    hpx::future<bool> written = part.write_checkpoint(dt, checkpoint_step, checkpoint_tau);
+
+    if (rank != 0)
+        return hpx::lcos::gather_there(checkpoint_basename, std::move(written),
+                                          checkpoint_step);
+
+    return hpx::lcos::gather_here(checkpoint_basename, std::move(written),
+                                     num_localities, checkpoint_step)
+        .then(
+            [this, checkpoint_step](hpx::future<std::vector<bool> > f)
+            {
+                std::vector<bool> const written = f.get();
+
+                // latest keeps naming the previous checkpoint, it may be the
+                // only one a run can restart from
+                if (std::find(written.begin(), written.end(), false) != written.end())
+                {
+                    std::cerr << "Error: the checkpoint after step " << checkpoint_step
+                        << " is incomplete, it is discarded!" << std::endl;
+
+                    if (checkpoint_step != last_checkpoint_step)
+                        io::checkpoint::discard(checkpoint_dir, checkpoint_step, num_localities);
+
+                    return;
+                }
+
+                if (!io::checkpoint::commit(checkpoint_dir, checkpoint_step,
+                        last_checkpoint_step, num_localities))
+                {
+                    std::cerr << "Error: the checkpoint after step " << checkpoint_step
+                        << " could not be committed, it is discarded!" << std::endl;
+
+                    if (checkpoint_step != last_checkpoint_step)
+                        io::checkpoint::discard(checkpoint_dir, checkpoint_step, num_localities);
+
+                    return;
+                }
+
+                last_checkpoint_step = checkpoint_step;
+
+                if (verbose)
+                    std::cout << "Checkpoint written after step " << checkpoint_step << std::endl;
+            }
+        );
+}
+
+void stepper_server::reduce_max_velocity(
+    hpx::shared_future<triple<double> > local_max_velocity, std::size_t current_step)
+{
+    hpx::future<triple<double> > reduced_velocity =
+        local_max_velocity.then(
+            [](hpx::shared_future<triple<double> > f)
+            {
+                return f.get();
+            }
+        );
+
+    // if this is the root locality gather all remote residuals and sum up
+    if (hpx::get_locality_id() == 0)
+    {
+        hpx::future<std::vector<triple<double> > >
+        max_velocities =
+            hpx::lcos::gather_here(velocity_basename,
+                                    std::move(reduced_velocity),
+                                    num_localities, current_step);
+
+        max_velocities.then(
+            hpx::util::unwrapping(
+                [=](std::vector<triple<double> > local_max_uvws)
+                {
+                    triple<double> global_max_uvw(0);
+
+                    for (auto& max_uvw : local_max_uvws)
                     {
-                        triple<double> global_max_uvw(0);
-
-                        for (auto& max_uvw : local_max_uvws)
-                        {
-                            global_max_uvw.x =
-                                (max_uvw.x > global_max_uvw.x
-                                    ? max_uvw.x : global_max_uvw.x);
-
-                            global_max_uvw.y =
-                                (max_uvw.y > global_max_uvw.y
-                                    ? max_uvw.y : global_max_uvw.y);
-
-                            global_max_uvw.z =
-                                (max_uvw.z > global_max_uvw.z
-                                    ? max_uvw.z : global_max_uvw.z);
-                        }
-
-                        double new_dt =
-                            std::min(re / 2. * 1. / (1. / std::pow(dx, 2)
-                                        + 1. / std::pow(dy, 2)
-                                        + 1. / std::pow(dz, 2))
-                                    ,
-                                    std::min(dx / global_max_uvw.x,
-                                            std::min(dy / global_max_uvw.y, dz / global_max_uvw.z))
-                            );
+                        global_max_uvw.x =
+                            (max_uvw.x > global_max_uvw.x
+                                ? max_uvw.x : global_max_uvw.x);
+
+                        global_max_uvw.y =
+                            (max_uvw.y > global_max_uvw.y
+                                ? max_uvw.y : global_max_uvw.y);
+
+                        global_max_uvw.z =
+                            (max_uvw.z > global_max_uvw.z
+                                ? max_uvw.z : global_max_uvw.z);
+                    }
+
+                    io::telemetry::record_velocity(current_step,
+                        global_max_uvw.x, global_max_uvw.y, global_max_uvw.z);
+
+                    double new_dt =
+                        std::min(re / 2. * 1. / (1. / std::pow(dx, 2)
+                                    + 1. / std::pow(dy, 2)
+                                    + 1. / std::pow(dz, 2))
+                                ,
+                                std::min(dx / global_max_uvw.x,
+                                        std::min(dy / global_max_uvw.y, dz / global_max_uvw.z))
+                        );
 
+                    if (adaptive_tau)
+                    {
+                        std::lock_guard<std::mutex> l(tau_mtx);
+                        new_dt = tau_control.next_dt(new_dt, std::chrono::steady_clock::now());
+                    }
+                    else
                         new_dt *= tau;
 
-                        hpx::lcos::broadcast_apply<set_dt_action>(localities, step, new_dt);
+                    bool checkpoint = (checkpoint_interval > 0
+                        && (current_step + 1) % checkpoint_interval == 0);
+
+                    if (checkpoint_walltime > 0)
+                    {
+                        std::lock_guard<std::mutex> l(checkpoint_mtx);
+                        auto const now = std::chrono::steady_clock::now();
+
+                        if (std::chrono::duration<double>(now - last_checkpoint).count()
+                                >= checkpoint_walltime)
+                            checkpoint = true;
+
+                        if (checkpoint)
+                            last_checkpoint = now;
                     }
-                )
-            );
-        }
-        else
-            hpx::lcos::gather_there(velocity_basename, std::move(local_max_velocity),
-                                       step);
-
-        if (t >= t_end)
-            break;
-        t += dt;
-        dt = dt_buffer.receive(step).get();
+
+                    hpx::lcos::broadcast_apply<set_dt_action>(localities, current_step, new_dt,
+                        checkpoint);
+                }
+            )
+        );
     }
+    else
+        hpx::lcos::gather_there(velocity_basename, std::move(reduced_velocity),
+                                   current_step);
 }
 
-void stepper_server::set_dt(uint step, double dt)
+void stepper_server::set_dt(uint step, double dt, bool checkpoint)
 {
+    // the flag has to be there once the dt is received
+    checkpoint_buffer.store_received(step, std::move(checkpoint));
     dt_buffer.store_received(step, std::move(dt));
 }
 
@@ -5,11 +5,18 @@
 #include "grid/partition.hpp"
 
 #include "util/hpx_wrap.hpp"
+#include "util/tau_controller.hpp"
+
+#include <chrono>
+#include <mutex>
+#include <string>
 
 namespace nast_hpx { namespace stepper { namespace server {
 
 char const* stepper_basename = "/nast_hpx/stepper/";
 char const* velocity_basename = "/nast_hpx/gather/velocity";
+char const* fluid_cells_basename = "/nast_hpx/gather/fluid_cells";
+char const* checkpoint_basename = "/nast_hpx/gather/checkpoint";
 char const* barrier_basename = "/nast_hpx/barrier";
 
 /// Component responsible for the timestepping and communication of data.
@@ -27,17 +34,39 @@ struct HPX_COMPONENT_EXPORT stepper_server
         void run();
         HPX_DEFINE_COMPONENT_ACTION(stepper_server, run, run_action);
 
-        void set_dt(uint step, double dt);
+        void set_dt(uint step, double dt, bool checkpoint);
         HPX_DEFINE_COMPONENT_ACTION(stepper_server, set_dt, set_dt_action);
 
     private:
+        /// Issues up to remaining timesteps, each one from a continuation of
+        /// the dt it depends on, and returns the future of the last one.
+        hpx::future<void> advance(std::size_t remaining);
+
+        /// writes the checkpoint of all partitions after the current step,
+        /// the root marks it complete once every locality has written its file
+        hpx::future<void> write_checkpoint();
+
+        void reduce_max_velocity(hpx::shared_future<triple<double> > local_max_velocity,
+            std::size_t current_step);
+
         uint num_localities, num_localities_x, num_localities_y, num_localities_z;
         hpx::lcos::local::receive_buffer<double> dt_buffer;
+        hpx::lcos::local::receive_buffer<bool> checkpoint_buffer;
 
         grid::partition part;
 
-        std::size_t rank, max_timesteps, step;
-        double init_dt, dx, dy, dz, re, pr, tau, t_end;
+        std::size_t rank, max_timesteps, step, local_step, pending_dt, chained_steps;
+        double init_dt, dx, dy, dz, re, pr, tau, t_end, t, dt;
+        bool dt_lookahead, verbose, finished, halo_summary, adaptive_tau;
+
+        util::tau_controller tau_control;
+        std::mutex tau_mtx;
+
+        std::size_t checkpoint_interval, last_checkpoint_step;
+        double checkpoint_walltime;
+        std::string checkpoint_dir, restart_file;
+        std::chrono::steady_clock::time_point last_checkpoint;
+        std::mutex checkpoint_mtx;
 
         std::vector<hpx::naming::id_type> localities;
 
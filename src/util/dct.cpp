@@ -0,0 +1,164 @@
+#include "dct.hpp"
+
+#include <cmath>
+#include <utility>
+
+namespace nast_hpx { namespace util {
+
+namespace {
+
+    double const pi = 3.14159265358979323846;
+
+    bool power_of_two(std::size_t n)
+    {
+        return n > 0 && (n & (n - 1)) == 0;
+    }
+
+    /// scratch of the calling thread, no task suspends inside a transform
+    std::vector<dct::complex>& scratch(std::size_t which, std::size_t size)
+    {
+        thread_local std::vector<dct::complex> buffers[2];
+
+        if (buffers[which].size() < size)
+            buffers[which].resize(size);
+
+        return buffers[which];
+    }
+}
+
+dct::dct(std::size_t n)
+: n_(n),
+  shift_(n)
+{
+    for (std::size_t k = 0; k < n; ++k)
+        shift_[k] = std::polar(1., -pi * k / (2. * n));
+
+    m_ = n;
+
+    if (!power_of_two(n))
+    {
+        m_ = 1;
+        while (m_ < 2 * n - 1)
+            m_ *= 2;
+    }
+
+    roots_.resize(m_ / 2);
+    for (std::size_t k = 0; k < m_ / 2; ++k)
+        roots_[k] = std::polar(1., -2. * pi * k / m_);
+
+    if (m_ == n)
+        return;
+
+    // k^2 mod 2n keeps the angle accurate for large k
+    chirp_.resize(n);
+    for (std::size_t k = 0; k < n; ++k)
+        chirp_[k] = std::polar(1., -pi * static_cast<double>((k * k) % (2 * n)) / n);
+
+    filter_.assign(m_, complex(0));
+    filter_[0] = std::conj(chirp_[0]);
+    for (std::size_t k = 1; k < n; ++k)
+        filter_[k] = filter_[m_ - k] = std::conj(chirp_[k]);
+
+    fft_radix2(filter_.data(), m_, roots_, false);
+}
+
+void dct::fft_radix2(complex* data, std::size_t m, std::vector<complex> const& roots,
+    bool inverse)
+{
+    for (std::size_t i = 1, j = 0; i < m; ++i)
+    {
+        std::size_t bit = m >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+
+        if (i < j)
+            std::swap(data[i], data[j]);
+    }
+
+    for (std::size_t len = 2; len <= m; len *= 2)
+    {
+        std::size_t const step = m / len;
+
+        for (std::size_t i = 0; i < m; i += len)
+        {
+            for (std::size_t k = 0; k < len / 2; ++k)
+            {
+                complex const w = inverse ? std::conj(roots[k * step]) : roots[k * step];
+                complex const u = data[i + k];
+                complex const v = data[i + k + len / 2] * w;
+
+                data[i + k] = u + v;
+                data[i + k + len / 2] = u - v;
+            }
+        }
+    }
+}
+
+void dct::fft(complex* data, bool inverse) const
+{
+    if (m_ == n_)
+    {
+        fft_radix2(data, m_, roots_, inverse);
+        return;
+    }
+
+    // the inverse is the conjugate of the forward transform of the conjugate
+    std::vector<complex>& padded = scratch(1, m_);
+
+    for (std::size_t k = 0; k < n_; ++k)
+        padded[k] = (inverse ? std::conj(data[k]) : data[k]) * chirp_[k];
+    for (std::size_t k = n_; k < m_; ++k)
+        padded[k] = 0;
+
+    fft_radix2(padded.data(), m_, roots_, false);
+
+    for (std::size_t k = 0; k < m_; ++k)
+        padded[k] *= filter_[k];
+
+    fft_radix2(padded.data(), m_, roots_, true);
+
+    for (std::size_t k = 0; k < n_; ++k)
+    {
+        complex const value = padded[k] * chirp_[k] / static_cast<double>(m_);
+        data[k] = inverse ? std::conj(value) : value;
+    }
+}
+
+void dct::forward(double* x, std::size_t stride) const
+{
+    std::vector<complex>& v = scratch(0, n_);
+
+    // even values up, odd ones down
+    for (std::size_t j = 0; 2 * j < n_; ++j)
+        v[j] = x[2 * j * stride];
+    for (std::size_t j = 0; 2 * j + 1 < n_; ++j)
+        v[n_ - 1 - j] = x[(2 * j + 1) * stride];
+
+    fft(v.data(), false);
+
+    for (std::size_t k = 0; k < n_; ++k)
+        x[k * stride] = (v[k] * shift_[k]).real();
+}
+
+void dct::inverse(double* x, std::size_t stride) const
+{
+    std::vector<complex>& v = scratch(0, n_);
+
+    // the FFT of the reordered values from X_k - i X_(n - k), X_n = 0
+    for (std::size_t k = 0; k < n_; ++k)
+        v[k] = std::conj(shift_[k])
+            * complex(x[k * stride], k == 0 ? 0. : -x[(n_ - k) * stride]);
+
+    fft(v.data(), true);
+
+    double const scale = 1. / n_;
+
+    for (std::size_t j = 0; 2 * j < n_; ++j)
+        x[2 * j * stride] = v[j].real() * scale;
+    for (std::size_t j = 0; 2 * j + 1 < n_; ++j)
+        x[(2 * j + 1) * stride] = v[n_ - 1 - j].real() * scale;
+}
+
+}
+}
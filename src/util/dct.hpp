@@ -0,0 +1,56 @@
+#ifndef NAST_HPX_UTIL_DCT_HPP_
+#define NAST_HPX_UTIL_DCT_HPP_
+
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+namespace nast_hpx { namespace util {
+
+/// Unnormalized DCT-II of a fixed length n,
+/// X_k = sum_j x_j cos(pi k (2 j + 1) / (2 n)), and its exact inverse. Both
+/// go through a complex FFT of length n (Makhoul), radix 2 for powers of two
+/// and Bluestein for any other length. The DCT-II diagonalizes the second
+/// difference with Neumann conditions at cell faces, with the eigenvalues
+/// 2 cos(pi k / n) - 2. A plan is immutable, so threads can share it.
+class dct
+{
+    public:
+        typedef std::complex<double> complex;
+
+        dct() = default;
+
+        explicit dct(std::size_t n);
+
+        std::size_t size() const { return n_; }
+
+        /// transforms the n values at x, x + stride, ... in place
+        void forward(double* x, std::size_t stride) const;
+        void inverse(double* x, std::size_t stride) const;
+
+    private:
+        /// in place, unnormalized in both directions
+        void fft(complex* data, bool inverse) const;
+
+        /// radix 2 for m a power of two, with the roots of length m
+        static void fft_radix2(complex* data, std::size_t m, std::vector<complex> const& roots,
+            bool inverse);
+
+        std::size_t n_ = 0;
+
+        /// e^(-i pi k / 2n)
+        std::vector<complex> shift_;
+
+        /// roots of the radix 2 length, n or the Bluestein padding
+        std::size_t m_ = 0;
+        std::vector<complex> roots_;
+
+        /// Bluestein chirp e^(-i pi k^2 / n) and the transformed filter
+        std::vector<complex> chirp_;
+        std::vector<complex> filter_;
+};
+
+}
+}
+
+#endif
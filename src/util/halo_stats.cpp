@@ -0,0 +1,183 @@
+#include "halo_stats.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <string>
+
+#include <hpx/include/performance_counters.hpp>
+
+namespace nast_hpx { namespace util {
+
+namespace {
+
+    struct link
+    {
+        std::atomic<std::uint64_t> messages_sent;
+        std::atomic<std::uint64_t> bytes_sent;
+        std::atomic<std::uint64_t> messages_received;
+        std::atomic<std::uint64_t> wait_time;
+    };
+
+    link links[halo_stats::num_directions][halo_stats::num_variables];
+
+    std::uint64_t read(std::atomic<std::uint64_t>& value, bool reset)
+    {
+        return reset ? value.exchange(0, std::memory_order_relaxed)
+            : value.load(std::memory_order_relaxed);
+    }
+
+    struct totals
+    {
+        std::uint64_t messages_sent = 0;
+        std::uint64_t bytes_sent = 0;
+        std::uint64_t messages_received = 0;
+        std::uint64_t wait_time = 0;
+
+        void add(std::size_t dir, std::size_t var)
+        {
+            messages_sent += halo_stats::messages_sent(dir, var);
+            bytes_sent += halo_stats::bytes_sent(dir, var);
+            messages_received += halo_stats::messages_received(dir, var);
+            wait_time += halo_stats::wait_time(dir, var);
+        }
+
+        void print(std::ostream& os, char const* name) const
+        {
+            if (messages_sent == 0 && messages_received == 0)
+                return;
+
+            char line[160];
+            std::snprintf(line, sizeof(line), "%-14s %12llu %12.3f %12llu %12.4f %14.2f", name,
+                static_cast<unsigned long long>(messages_sent), bytes_sent * 1e-6,
+                static_cast<unsigned long long>(messages_received), wait_time * 1e-9,
+                messages_received > 0 ? wait_time * 1e-3 / messages_received : 0.);
+            os << line << "\n";
+        }
+    };
+
+    void print_header(std::ostream& os, char const* first)
+    {
+        char line[160];
+        std::snprintf(line, sizeof(line), "%-14s %12s %12s %12s %12s %14s", first,
+            "sent", "MB sent", "received", "wait (s)", "wait/msg (us)");
+        os << line << "\n";
+    }
+}
+
+char const* halo_stats::direction_name(std::size_t dir)
+{
+    static char const* const names[num_directions] = {
+        "left", "bottom", "back", "back_left", "bottom_right", "back_bottom",
+        "front_top", "top_left", "front_right", "front", "top", "right"
+    };
+
+    return names[dir];
+}
+
+char const* halo_stats::variable_name(std::size_t var)
+{
+    static char const* const names[num_variables] = {"U", "V", "W", "F", "G", "H", "P"};
+
+    return names[var];
+}
+
+void halo_stats::sent(std::size_t dir, std::size_t var, std::uint64_t bytes)
+{
+    links[dir][var].messages_sent.fetch_add(1, std::memory_order_relaxed);
+    links[dir][var].bytes_sent.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void halo_stats::received(std::size_t dir, std::size_t var, std::uint64_t wait_nanoseconds)
+{
+    links[dir][var].messages_received.fetch_add(1, std::memory_order_relaxed);
+    links[dir][var].wait_time.fetch_add(wait_nanoseconds, std::memory_order_relaxed);
+}
+
+std::uint64_t halo_stats::messages_sent(std::size_t dir, std::size_t var, bool reset)
+{
+    return read(links[dir][var].messages_sent, reset);
+}
+
+std::uint64_t halo_stats::bytes_sent(std::size_t dir, std::size_t var, bool reset)
+{
+    return read(links[dir][var].bytes_sent, reset);
+}
+
+std::uint64_t halo_stats::messages_received(std::size_t dir, std::size_t var, bool reset)
+{
+    return read(links[dir][var].messages_received, reset);
+}
+
+std::uint64_t halo_stats::wait_time(std::size_t dir, std::size_t var, bool reset)
+{
+    return read(links[dir][var].wait_time, reset);
+}
+
+void halo_stats::register_counters()
+{
+    for (std::size_t dir = 0; dir < num_directions; ++dir)
+    {
+        for (std::size_t var = 0; var < num_variables; ++var)
+        {
+            std::string const link = std::string(direction_name(dir)) + "/" + variable_name(var);
+            std::string const prefix = "/nast_hpx/halo/" + link;
+
+            hpx::performance_counters::install_counter_type(prefix + "/messages_sent",
+                [dir, var](bool reset) -> std::int64_t { return messages_sent(dir, var, reset); },
+                "number of halo messages sent to the " + link + " neighbor");
+
+            hpx::performance_counters::install_counter_type(prefix + "/bytes_sent",
+                [dir, var](bool reset) -> std::int64_t { return bytes_sent(dir, var, reset); },
+                "bytes of halo data sent to the " + link + " neighbor", "bytes");
+
+            hpx::performance_counters::install_counter_type(prefix + "/messages_received",
+                [dir, var](bool reset) -> std::int64_t { return messages_received(dir, var, reset); },
+                "number of halo messages received from the " + link + " neighbor");
+
+            hpx::performance_counters::install_counter_type(prefix + "/wait_time",
+                [dir, var](bool reset) -> std::int64_t { return wait_time(dir, var, reset); },
+                "time blocked on halos from the " + link + " neighbor", "ns");
+        }
+    }
+}
+
+void halo_stats::report(std::ostream& os, std::size_t rank)
+{
+    os << "Halo exchange on locality " << rank << "\n";
+
+    print_header(os, "direction");
+
+    totals all;
+
+    for (std::size_t dir = 0; dir < num_directions; ++dir)
+    {
+        totals t;
+
+        for (std::size_t var = 0; var < num_variables; ++var)
+        {
+            t.add(dir, var);
+            all.add(dir, var);
+        }
+
+        t.print(os, direction_name(dir));
+    }
+
+    print_header(os, "variable");
+
+    for (std::size_t var = 0; var < num_variables; ++var)
+    {
+        totals t;
+
+        for (std::size_t dir = 0; dir < num_directions; ++dir)
+            t.add(dir, var);
+
+        t.print(os, variable_name(var));
+    }
+
+    all.print(os, "total");
+
+    os << std::flush;
+}
+
+}
+}
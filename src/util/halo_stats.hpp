@@ -0,0 +1,43 @@
+#ifndef NAST_HPX_UTIL_HALO_STATS_HPP_
+#define NAST_HPX_UTIL_HALO_STATS_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+namespace nast_hpx { namespace util {
+
+/// Messages and bytes sent and the time blocked on received halos of this
+/// locality, per direction and variable of the partition. The totals are
+/// exposed as the performance counters
+/// /nast_hpx{locality#N/total}/halo/<direction>/<variable>/messages_sent,
+/// .../bytes_sent, .../messages_received and .../wait_time (ns).
+struct halo_stats
+{
+    static std::size_t const num_directions = 12;
+    static std::size_t const num_variables = 7;
+
+    /// in the order of grid::direction and of the partition variables
+    static char const* direction_name(std::size_t dir);
+    static char const* variable_name(std::size_t var);
+
+    static void sent(std::size_t dir, std::size_t var, std::uint64_t bytes);
+
+    static void received(std::size_t dir, std::size_t var, std::uint64_t wait_nanoseconds);
+
+    static std::uint64_t messages_sent(std::size_t dir, std::size_t var, bool reset = false);
+    static std::uint64_t bytes_sent(std::size_t dir, std::size_t var, bool reset = false);
+    static std::uint64_t messages_received(std::size_t dir, std::size_t var, bool reset = false);
+    static std::uint64_t wait_time(std::size_t dir, std::size_t var, bool reset = false);
+
+    /// installs the counter types, must run before the runtime starts
+    static void register_counters();
+
+    /// totals per direction and per variable
+    static void report(std::ostream& os, std::size_t rank);
+};
+
+}
+}
+
+#endif
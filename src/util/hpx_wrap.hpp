@@ -19,5 +19,7 @@
 
 #include <hpx/lcos/local/receive_buffer.hpp>
 
+#include <hpx/include/thread_executors.hpp>
+
 #endif // HPX_WRAP_HPP
 
@@ -0,0 +1,264 @@
+#include "hw_counters.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace nast_hpx { namespace util {
+
+namespace {
+
+    std::atomic<bool> counting{false};
+    std::atomic<bool> warned{false};
+    double balance = 0;
+
+    std::atomic<std::uint64_t> values[phase_timer::num_phases][hw_counters::num_events];
+    std::atomic<std::uint64_t> counted_cells[phase_timer::num_phases];
+
+    /// the events of a thread are one group, read at once
+    struct thread_counters
+    {
+        bool opened = false;
+        int leader = -1;
+        int fds[hw_counters::num_events];
+
+        thread_counters()
+        {
+            for (int& fd : fds)
+                fd = -1;
+        }
+
+        ~thread_counters()
+        {
+#if defined(__linux__)
+            for (int fd : fds)
+                if (fd >= 0)
+                    close(fd);
+#endif
+        }
+    };
+
+#if defined(__linux__)
+    int open_event(std::uint64_t config, int group)
+    {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = config;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP
+            | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group, 0));
+    }
+
+    bool open(thread_counters& t)
+    {
+        static std::uint64_t const configs[hw_counters::num_events] = {
+            PERF_COUNT_HW_CPU_CYCLES,
+            PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_MISSES
+        };
+
+        t.opened = true;
+
+        for (std::size_t e = 0; e < hw_counters::num_events; ++e)
+        {
+            t.fds[e] = open_event(configs[e], t.leader);
+
+            if (t.fds[e] < 0)
+            {
+                if (!warned.exchange(true))
+                    std::cerr << "Warning: perf events are not available ("
+                        << std::strerror(errno) << "), no hardware counters!" << std::endl;
+
+                for (std::size_t i = 0; i < e; ++i)
+                {
+                    close(t.fds[i]);
+                    t.fds[i] = -1;
+                }
+
+                t.leader = -1;
+                return false;
+            }
+
+            if (e == 0)
+                t.leader = t.fds[0];
+        }
+
+        ioctl(t.leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(t.leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+
+        return true;
+    }
+#endif
+
+    double per_cell(phase_timer::phase p, hw_counters::event e)
+    {
+        std::uint64_t const cells = hw_counters::cells(p);
+        return cells > 0 ? static_cast<double>(hw_counters::value(p, e)) / cells : 0.;
+    }
+
+    // every last level cache miss is taken as one line from memory
+    double const line_bytes = 64;
+}
+
+void hw_counters::enable(double machine_balance)
+{
+    balance = machine_balance;
+    counting = true;
+}
+
+bool hw_counters::enabled()
+{
+    return counting.load(std::memory_order_relaxed);
+}
+
+bool hw_counters::read(std::uint64_t (&result)[num_events])
+{
+#if defined(__linux__)
+    thread_local thread_counters t;
+
+    if (!t.opened)
+        open(t);
+
+    if (t.leader < 0)
+        return false;
+
+    // nr, time enabled, time running, then the values of the group
+    std::uint64_t buffer[3 + num_events];
+
+    if (::read(t.leader, buffer, sizeof(buffer)) != static_cast<ssize_t>(sizeof(buffer)))
+        return false;
+
+    // scaled up if the group was multiplexed with other events
+    double const scale = buffer[2] > 0 ? static_cast<double>(buffer[1]) / buffer[2] : 1.;
+
+    for (std::size_t e = 0; e < num_events; ++e)
+        result[e] = static_cast<std::uint64_t>(buffer[3 + e] * scale);
+
+    return true;
+#else
+    if (!warned.exchange(true))
+        std::cerr << "Warning: hardware counters are only available on Linux!" << std::endl;
+
+    return false;
+#endif
+}
+
+void hw_counters::add(phase_timer::phase p, std::uint64_t cells,
+    std::uint64_t const (&begin)[num_events], std::uint64_t const (&end)[num_events])
+{
+    for (std::size_t e = 0; e < num_events; ++e)
+        values[p][e].fetch_add(end[e] - begin[e], std::memory_order_relaxed);
+
+    counted_cells[p].fetch_add(cells, std::memory_order_relaxed);
+}
+
+std::uint64_t hw_counters::value(phase_timer::phase p, event e)
+{
+    return values[p][e].load(std::memory_order_relaxed);
+}
+
+std::uint64_t hw_counters::cells(phase_timer::phase p)
+{
+    return counted_cells[p].load(std::memory_order_relaxed);
+}
+
+double hw_counters::flops_per_cell(phase_timer::phase p)
+{
+    // counted in the source of the stencils, divisions as one flop
+    switch (p)
+    {
+    case phase_timer::set_velocity:     return 3;
+    case phase_timer::compute_fg:       return 270;
+    case phase_timer::compute_rhs:      return 10;
+    case phase_timer::extrapolate_p:    return 5;
+    case phase_timer::set_p:            return 17;
+    case phase_timer::jacobi:           return 10;
+    case phase_timer::chebyshev:        return 5;
+    case phase_timer::residual:         return 17;
+    case phase_timer::update_velocity:  return 12;
+    default:                            return 0;
+    }
+}
+
+double hw_counters::bytes_per_cell(phase_timer::phase p)
+{
+    // the cell index, the flags and every field read or written once
+    double const index = 3 * sizeof(std::size_t);
+    double const flags = 8;
+    double const value = sizeof(double);
+
+    switch (p)
+    {
+    case phase_timer::set_velocity:     return index + flags + 6 * value;
+    case phase_timer::compute_fg:       return index + flags + 6 * value;
+    case phase_timer::compute_rhs:      return index + 4 * value;
+    case phase_timer::extrapolate_p:    return index + 6 * value;
+    case phase_timer::set_p:            return index + flags + 2 * value;
+    case phase_timer::jacobi:           return index + 3 * value;
+    case phase_timer::chebyshev:        return index + 5 * value;
+    case phase_timer::residual:         return index + 2 * value;
+    case phase_timer::update_velocity:  return index + flags + 7 * value;
+    default:                            return 0;
+    }
+}
+
+void hw_counters::report(std::ostream& os, std::size_t rank)
+{
+    os << "Hardware counters on locality " << rank
+        << " (bytes from last level cache misses, intensity in flops/byte)\n";
+
+    char line[200];
+    std::snprintf(line, sizeof(line), "%-16s %12s %6s %10s %10s %10s %8s %8s %9s %9s %8s",
+        "phase", "cells", "IPC", "cyc/cell", "B/cell", "B/cell mod", "AI", "AI mod",
+        "GFLOP/s", "GB/s", "bound");
+    os << line << "\n";
+
+    for (std::size_t i = 0; i < phase_timer::num_phases; ++i)
+    {
+        phase_timer::phase const p = static_cast<phase_timer::phase>(i);
+
+        if (cells(p) == 0 || flops_per_cell(p) == 0)
+            continue;
+
+        double const bytes = per_cell(p, cache_misses) * line_bytes;
+        double const flops = flops_per_cell(p);
+        double const intensity = bytes > 0 ? flops / bytes : 0.;
+
+        // per thread, the phase time is summed over the threads
+        double const seconds = phase_timer::time(p) * 1e-9;
+        double const gflops = seconds > 0 ? flops * cells(p) / seconds * 1e-9 : 0.;
+        double const gbytes = seconds > 0 ? bytes * cells(p) / seconds * 1e-9 : 0.;
+
+        char const* bound = "-";
+        if (balance > 0)
+            bound = (bytes > 0 && intensity < balance) ? "memory" : "compute";
+
+        std::snprintf(line, sizeof(line),
+            "%-16s %12llu %6.2f %10.1f %10.1f %10.1f %8.3f %8.3f %9.2f %9.2f %8s",
+            phase_timer::name(p), static_cast<unsigned long long>(cells(p)),
+            value(p, cycles) > 0 ? static_cast<double>(value(p, instructions)) / value(p, cycles) : 0.,
+            per_cell(p, cycles), bytes, bytes_per_cell(p),
+            bytes > 0 ? intensity : 0., flops / bytes_per_cell(p), gflops, gbytes, bound);
+        os << line << "\n";
+    }
+
+    os << std::flush;
+}
+
+}
+}
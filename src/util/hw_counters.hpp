@@ -0,0 +1,120 @@
+#ifndef NAST_HPX_UTIL_HW_COUNTERS_HPP_
+#define NAST_HPX_UTIL_HW_COUNTERS_HPP_
+
+#include "cancellation_token.hpp"
+#include "phase_timer.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <type_traits>
+#include <utility>
+
+namespace nast_hpx { namespace util {
+
+/// Cycles, instructions and last level cache misses of the stencil kernels,
+/// read with perf_event_open for the calling thread and summed per phase on
+/// this locality. The report sets them against the flops and compulsory
+/// bytes per cell of each kernel. Where perf events are not available
+/// (other systems, perf_event_paranoid) nothing is counted.
+struct hw_counters
+{
+    enum event
+    {
+        cycles,
+        instructions,
+        cache_misses,
+        num_events
+    };
+
+    /// machine_balance is the peak flops per byte of memory bandwidth, the
+    /// kernels are classified as memory or compute bound against it if > 0
+    static void enable(double machine_balance);
+
+    static bool enabled();
+
+    /// counts of the calling thread so far, false if not available
+    static bool read(std::uint64_t (&values)[num_events]);
+
+    static void add(phase_timer::phase p, std::uint64_t cells,
+        std::uint64_t const (&begin)[num_events], std::uint64_t const (&end)[num_events]);
+
+    static std::uint64_t value(phase_timer::phase p, event e);
+
+    static std::uint64_t cells(phase_timer::phase p);
+
+    /// source level estimates for the kernel of a phase, 0 if it has none
+    static double flops_per_cell(phase_timer::phase p);
+    static double bytes_per_cell(phase_timer::phase p);
+
+    /// table of the counted phases with their arithmetic intensity
+    static void report(std::ostream& os, std::size_t rank);
+
+    /// counts its lifetime for the cells of the phase
+    struct scope
+    {
+        scope(phase_timer::phase p, std::uint64_t cells)
+          : p_(p), cells_(cells), valid_(cells > 0 && enabled() && read(begin_))
+        {}
+
+        ~scope()
+        {
+            std::uint64_t end[num_events];
+
+            if (valid_ && read(end))
+                add(p_, cells_, begin_, end);
+        }
+
+        scope(scope const&) = delete;
+        scope& operator=(scope const&) = delete;
+
+    private:
+        phase_timer::phase p_;
+        std::uint64_t cells_;
+        bool valid_;
+        std::uint64_t begin_[num_events];
+    };
+};
+
+/// callable counting each call of the wrapped kernel, calls after the
+/// solver was cancelled do no work and are not counted, the token is the
+/// one of the step the call belongs to
+template <typename F>
+struct counted_call
+{
+    phase_timer::phase p;
+    std::uint64_t cells;
+    bool cancellable;
+    cancellation_token token;
+    F f;
+
+    template <typename... Ts>
+    auto operator()(Ts&&... ts) -> decltype(f(std::forward<Ts>(ts)...))
+    {
+        hw_counters::scope s(p, cancellable && token.was_cancelled() ? 0 : cells);
+        return f(std::forward<Ts>(ts)...);
+    }
+};
+
+template <typename F>
+counted_call<typename std::decay<F>::type> counted(phase_timer::phase p, std::uint64_t cells,
+    F&& f)
+{
+    // shared, so wrapping a kernel does not allocate a flag
+    static cancellation_token const never_cancelled;
+
+    return counted_call<typename std::decay<F>::type>{
+        p, cells, false, never_cancelled, std::forward<F>(f)};
+}
+
+template <typename F>
+counted_call<typename std::decay<F>::type> counted(phase_timer::phase p, std::uint64_t cells,
+    cancellation_token const& token, F&& f)
+{
+    return counted_call<typename std::decay<F>::type>{p, cells, true, token, std::forward<F>(f)};
+}
+
+}
+}
+
+#endif
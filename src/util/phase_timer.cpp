@@ -0,0 +1,78 @@
+#include "phase_timer.hpp"
+
+#include <atomic>
+#include <string>
+
+#include <hpx/include/performance_counters.hpp>
+
+namespace nast_hpx { namespace util {
+
+namespace {
+
+    std::atomic<std::uint64_t> times[phase_timer::num_phases];
+    std::atomic<std::uint64_t> counts[phase_timer::num_phases];
+
+    std::uint64_t read(std::atomic<std::uint64_t>& value, bool reset)
+    {
+        return reset ? value.exchange(0, std::memory_order_relaxed)
+            : value.load(std::memory_order_relaxed);
+    }
+}
+
+char const* phase_timer::name(phase p)
+{
+    static char const* const names[num_phases] = {
+        "set_velocity",
+        "halo_send",
+        "halo_wait",
+        "fg",
+        "rhs",
+        "extrapolate_p",
+        "set_p",
+        "jacobi",
+        "chebyshev",
+        "direct_solve",
+        "residual",
+        "residual_reduction",
+        "update_velocity",
+        "output"
+    };
+
+    return names[p];
+}
+
+void phase_timer::add(phase p, std::uint64_t nanoseconds)
+{
+    times[p].fetch_add(nanoseconds, std::memory_order_relaxed);
+    counts[p].fetch_add(1, std::memory_order_relaxed);
+}
+
+std::uint64_t phase_timer::time(phase p, bool reset)
+{
+    return read(times[p], reset);
+}
+
+std::uint64_t phase_timer::count(phase p, bool reset)
+{
+    return read(counts[p], reset);
+}
+
+void phase_timer::register_counters()
+{
+    for (std::size_t i = 0; i < num_phases; ++i)
+    {
+        phase const p = static_cast<phase>(i);
+        std::string const prefix = std::string("/nast_hpx/phase/") + name(p);
+
+        hpx::performance_counters::install_counter_type(prefix + "/time",
+            [p](bool reset) -> std::int64_t { return time(p, reset); },
+            std::string("cumulative time spent in the ") + name(p) + " phase", "ns");
+
+        hpx::performance_counters::install_counter_type(prefix + "/count",
+            [p](bool reset) -> std::int64_t { return count(p, reset); },
+            std::string("number of invocations of the ") + name(p) + " phase");
+    }
+}
+
+}
+}
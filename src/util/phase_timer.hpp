@@ -0,0 +1,109 @@
+#ifndef NAST_HPX_UTIL_PHASE_TIMER_HPP_
+#define NAST_HPX_UTIL_PHASE_TIMER_HPP_
+
+#include "trace.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+namespace nast_hpx { namespace util {
+
+/// Cumulative time and number of invocations of the phases of a timestep on
+/// this locality. The totals are exposed as the performance counters
+/// /nast_hpx{locality#N/total}/phase/<name>/time (ns) and .../count.
+struct phase_timer
+{
+    enum phase
+    {
+        set_velocity,
+        halo_send,
+        halo_wait,
+        compute_fg,
+        compute_rhs,
+        extrapolate_p,
+        set_p,
+        jacobi,
+        chebyshev,
+        direct_solve,
+        residual,
+        residual_reduction,
+        update_velocity,
+        output,
+        num_phases
+    };
+
+    static char const* name(phase p);
+
+    static void add(phase p, std::uint64_t nanoseconds);
+
+    /// cumulative time in ns, optionally reset to 0
+    static std::uint64_t time(phase p, bool reset = false);
+
+    static std::uint64_t count(phase p, bool reset = false);
+
+    /// installs the counter types, must run before the runtime starts
+    static void register_counters();
+
+    /// adds its lifetime to the phase, and to the trace if it is recorded
+    struct scope
+    {
+        scope(phase p, trace::tags const& tags = trace::tags())
+          : p_(p), tags_(tags), start_(std::chrono::steady_clock::now())
+        {}
+
+        ~scope()
+        {
+            std::chrono::steady_clock::time_point const end = std::chrono::steady_clock::now();
+
+            add(p_, std::chrono::duration_cast<std::chrono::nanoseconds>(end - start_).count());
+
+            if (trace::enabled())
+                trace::record(name(p_), start_, end, tags_);
+        }
+
+        scope(scope const&) = delete;
+        scope& operator=(scope const&) = delete;
+
+    private:
+        phase p_;
+        trace::tags tags_;
+        std::chrono::steady_clock::time_point start_;
+    };
+};
+
+/// callable timing each call of the wrapped one as a phase
+template <typename F>
+struct timed_call
+{
+    phase_timer::phase p;
+    trace::tags tags;
+    F f;
+
+    template <typename... Ts>
+    auto operator()(Ts&&... ts) -> decltype(f(std::forward<Ts>(ts)...))
+    {
+        phase_timer::scope s(p, tags);
+        return f(std::forward<Ts>(ts)...);
+    }
+};
+
+template <typename F>
+timed_call<typename std::decay<F>::type> timed(phase_timer::phase p, F&& f)
+{
+    return timed_call<typename std::decay<F>::type>{p, trace::tags(), std::forward<F>(f)};
+}
+
+/// tags the traced calls with the step, iteration and chunk they work on
+template <typename F>
+timed_call<typename std::decay<F>::type> timed(phase_timer::phase p, trace::tags const& tags,
+    F&& f)
+{
+    return timed_call<typename std::decay<F>::type>{p, tags, std::forward<F>(f)};
+}
+
+}
+}
+
+#endif
@@ -0,0 +1,100 @@
+#include "tau_controller.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+
+namespace nast_hpx { namespace util {
+
+namespace {
+
+    std::atomic<std::size_t> solved_steps{0};
+    std::atomic<std::size_t> solver_iterations{0};
+    std::atomic<std::size_t> unconverged_steps{0};
+}
+
+tau_controller::tau_controller(double tau, double tau_min, double tau_max,
+    std::size_t window, double factor, bool verbose)
+: tau_(std::min(std::max(tau, tau_min), tau_max)),
+  tau_min_(tau_min),
+  tau_max_(tau_max),
+  factor_(factor),
+  window_(window),
+  verbose_(verbose)
+{}
+
+double tau_controller::next_dt(double dt_bound, clock::time_point now)
+{
+    double const dt = dt_bound * tau_;
+
+    // the window starts with the first reduced step
+    if (!started_)
+    {
+        started_ = true;
+        window_start_ = now;
+        return dt;
+    }
+
+    ++window_steps_;
+    window_time_ += dt;
+
+    if (window_steps_ < window_)
+        return dt;
+
+    double const wall_time = std::chrono::duration<double>(now - window_start_).count();
+
+    if (wall_time > 0)
+        adapt(window_time_ / wall_time, window_steps_);
+
+    window_start_ = now;
+    window_steps_ = 0;
+    window_time_ = 0;
+
+    return dt;
+}
+
+void tau_controller::record_iterations(std::size_t iterations, bool converged)
+{
+    solved_steps.fetch_add(1, std::memory_order_relaxed);
+    solver_iterations.fetch_add(iterations, std::memory_order_relaxed);
+
+    if (!converged)
+        unconverged_steps.fetch_add(1, std::memory_order_relaxed);
+}
+
+void tau_controller::adapt(double rate, std::size_t steps)
+{
+    std::size_t const solved = solved_steps.exchange(0, std::memory_order_relaxed);
+    std::size_t const iterations = solver_iterations.exchange(0, std::memory_order_relaxed);
+    std::size_t const unconverged = unconverged_steps.exchange(0, std::memory_order_relaxed);
+
+    double const old_tau = tau_;
+
+    // a solver at iter_max leaves a residual above eps, that is no speedup
+    if (unconverged > 0)
+        direction_ = -1;
+    else if (last_rate_ > 0 && rate < last_rate_)
+        direction_ = -direction_;
+
+    tau_ = direction_ > 0 ? tau_ * factor_ : tau_ / factor_;
+    tau_ = std::min(std::max(tau_, tau_min_), tau_max_);
+
+    // at a bound the only way to probe is back
+    if (tau_ == tau_max_)
+        direction_ = -1;
+    else if (tau_ == tau_min_)
+        direction_ = 1;
+
+    last_rate_ = rate;
+
+    if (verbose_)
+        std::cout << "tau = " << old_tau << " -> " << tau_
+            << ", simulated time per second = " << rate
+            << " over " << steps << " steps"
+            << ", iterations per step = "
+            << (solved > 0 ? static_cast<double>(iterations) / solved : 0.)
+            << ", unconverged steps = " << unconverged << std::endl;
+}
+
+}
+}
@@ -0,0 +1,57 @@
+#ifndef NAST_HPX_UTIL_TAU_CONTROLLER_HPP_
+#define NAST_HPX_UTIL_TAU_CONTROLLER_HPP_
+
+#include <chrono>
+#include <cstddef>
+
+namespace nast_hpx { namespace util {
+
+/// Adapts the safety factor tau of the timestep on the root, within
+/// [tau_min, tau_max], to the most simulated time per second of wall time.
+/// After every window of steps the throughput of the window is compared with
+/// the one before, tau keeps moving by factor while it improves and turns
+/// around when it drops. A window in which the pressure solver hit iter_max
+/// always lowers tau.
+class tau_controller
+{
+    public:
+        typedef std::chrono::steady_clock clock;
+
+        tau_controller() = default;
+
+        tau_controller(double tau, double tau_min, double tau_max, std::size_t window,
+            double factor, bool verbose);
+
+        double tau() const { return tau_; }
+
+        /// the dt of the next step for the stability bound dt_bound, also
+        /// counts the step reduced at now into the current window
+        double next_dt(double dt_bound, clock::time_point now);
+
+        /// iterations of the pressure solve of a step, from the root partition
+        static void record_iterations(std::size_t iterations, bool converged);
+
+    private:
+        void adapt(double rate, std::size_t steps);
+
+        double tau_ = 1;
+        double tau_min_ = 1;
+        double tau_max_ = 1;
+        double factor_ = 1;
+        std::size_t window_ = 1;
+        bool verbose_ = false;
+
+        /// +1 while tau grows, -1 while it shrinks
+        int direction_ = 1;
+        double last_rate_ = 0;
+
+        bool started_ = false;
+        clock::time_point window_start_;
+        std::size_t window_steps_ = 0;
+        double window_time_ = 0;
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,187 @@
+#include "trace.hpp"
+
+#include "halo_stats.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace nast_hpx { namespace util {
+
+std::atomic<bool> trace::enabled_{false};
+
+namespace {
+
+    struct event
+    {
+        char const* name;
+        std::int64_t begin;
+        std::int64_t end;
+        trace::tags tags;
+    };
+
+    /// only the owning thread appends, the buffer never reallocates
+    struct thread_buffer
+    {
+        std::size_t thread;
+        std::vector<event> events;
+        std::size_t dropped = 0;
+    };
+
+    struct trace_state
+    {
+        std::string prefix;
+        std::size_t rank = 0;
+        std::size_t capacity = 0;
+
+        std::vector<std::unique_ptr<thread_buffer> > buffers;
+        std::mutex mtx;
+    };
+
+    trace_state& state()
+    {
+        static trace_state s;
+        return s;
+    }
+
+    /// registered once per thread, the only time it has to lock
+    thread_buffer& local_buffer()
+    {
+        thread_local thread_buffer* buffer = nullptr;
+
+        if (buffer == nullptr)
+        {
+            trace_state& s = state();
+            std::lock_guard<std::mutex> l(s.mtx);
+
+            s.buffers.emplace_back(new thread_buffer);
+            buffer = s.buffers.back().get();
+            buffer->thread = s.buffers.size() - 1;
+            buffer->events.reserve(s.capacity);
+        }
+
+        return *buffer;
+    }
+
+    std::int64_t nanoseconds(std::chrono::steady_clock::time_point t)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+    }
+
+    void write_args(std::ostream& os, trace::tags const& t)
+    {
+        char const* sep = "";
+
+        if (t.step >= 0)
+        {
+            os << sep << "\"step\":" << t.step;
+            sep = ",";
+        }
+        if (t.iter >= 0)
+        {
+            os << sep << "\"iter\":" << t.iter;
+            sep = ",";
+        }
+        if (t.chunk >= 0)
+        {
+            os << sep << "\"chunk\":" << t.chunk;
+            sep = ",";
+        }
+        if (t.message >= 0)
+        {
+            os << sep << "\"message\":" << t.message;
+            sep = ",";
+        }
+        if (t.var >= 0 && static_cast<std::size_t>(t.var) < halo_stats::num_variables)
+        {
+            os << sep << "\"var\":\"" << halo_stats::variable_name(t.var) << "\"";
+            sep = ",";
+        }
+        if (t.dir >= 0 && static_cast<std::size_t>(t.dir) < halo_stats::num_directions)
+            os << sep << "\"dir\":\"" << halo_stats::direction_name(t.dir) << "\"";
+    }
+}
+
+void trace::start(std::string const& prefix, std::size_t rank, std::size_t events_per_thread)
+{
+    trace_state& s = state();
+
+    {
+        std::lock_guard<std::mutex> l(s.mtx);
+
+        s.prefix = prefix;
+        s.rank = rank;
+        s.capacity = events_per_thread;
+    }
+
+    enabled_ = true;
+}
+
+void trace::record(char const* name, std::chrono::steady_clock::time_point begin,
+    std::chrono::steady_clock::time_point end, tags const& t)
+{
+    thread_buffer& buffer = local_buffer();
+
+    if (buffer.events.size() == buffer.events.capacity())
+    {
+        ++buffer.dropped;
+        return;
+    }
+
+    buffer.events.push_back(event{name, nanoseconds(begin), nanoseconds(end), t});
+}
+
+void trace::write()
+{
+    if (!enabled())
+        return;
+
+    trace_state& s = state();
+    std::lock_guard<std::mutex> l(s.mtx);
+
+    std::string const filename = s.prefix + "_locality_" + std::to_string(s.rank) + ".json";
+    std::ofstream file(filename, std::ios::trunc);
+
+    // timestamps in microseconds of the steady clock, so the localities of
+    // one machine line up when merged
+    file.precision(15);
+    file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n"
+        << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << s.rank
+        << ",\"args\":{\"name\":\"locality " << s.rank << "\"}}";
+
+    std::size_t dropped = 0;
+
+    for (auto const& buffer : s.buffers)
+    {
+        file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << s.rank
+            << ",\"tid\":" << buffer->thread
+            << ",\"args\":{\"name\":\"worker " << buffer->thread << "\"}}";
+
+        for (event const& e : buffer->events)
+        {
+            file << ",\n{\"name\":\"" << e.name << "\",\"ph\":\"X\",\"pid\":" << s.rank
+                << ",\"tid\":" << buffer->thread
+                << ",\"ts\":" << e.begin * 1e-3
+                << ",\"dur\":" << (e.end - e.begin) * 1e-3
+                << ",\"args\":{";
+            write_args(file, e.tags);
+            file << "}}";
+        }
+
+        dropped += buffer->dropped;
+    }
+
+    file << "\n]}\n";
+
+    if (!file)
+        std::cerr << "Error: could not write " << filename << "!" << std::endl;
+
+    if (dropped > 0)
+        std::cerr << "Warning: " << dropped << " trace events dropped on locality " << s.rank
+            << ", the Trace buffer is too small!" << std::endl;
+}
+
+}
+}
@@ -0,0 +1,85 @@
+#ifndef NAST_HPX_UTIL_TRACE_HPP_
+#define NAST_HPX_UTIL_TRACE_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace nast_hpx { namespace util {
+
+/// Begin and end of the tasks of a timestep on this locality, written as a
+/// Chrome trace (chrome://tracing, ui.perfetto.dev) to
+/// <prefix>_locality_<rank>.json. Every worker thread appends to a buffer of
+/// its own with a fixed capacity, events beyond it are dropped.
+struct trace
+{
+    /// what a task worked on, negative if not known
+    struct tags
+    {
+        tags(std::int64_t step_ = -1, std::int32_t iter_ = -1, std::int32_t chunk_ = -1)
+          : step(step_), iter(iter_), chunk(chunk_), message(-1), var(-1), dir(-1)
+        {}
+
+        /// message of a halo exchange, the step for all but P
+        static tags halo(std::int64_t message, std::int32_t var, std::int32_t dir)
+        {
+            tags t;
+            t.message = message;
+            t.var = var;
+            t.dir = dir;
+            return t;
+        }
+
+        std::int64_t step;
+        std::int32_t iter;
+        std::int32_t chunk;
+        std::int64_t message;
+        std::int32_t var;
+        std::int32_t dir;
+    };
+
+    /// starts recording, the events of earlier runs are kept
+    static void start(std::string const& prefix, std::size_t rank, std::size_t events_per_thread);
+
+    static bool enabled()
+    {
+        return enabled_.load(std::memory_order_relaxed);
+    }
+
+    static void record(char const* name, std::chrono::steady_clock::time_point begin,
+        std::chrono::steady_clock::time_point end, tags const& t);
+
+    /// writes all events recorded so far, no task may be recording
+    static void write();
+
+    /// records its lifetime as a task of its own
+    struct scope
+    {
+        scope(char const* name, tags const& t = tags())
+          : name_(name), tags_(t), start_(std::chrono::steady_clock::now())
+        {}
+
+        ~scope()
+        {
+            if (enabled())
+                record(name_, start_, std::chrono::steady_clock::now(), tags_);
+        }
+
+        scope(scope const&) = delete;
+        scope& operator=(scope const&) = delete;
+
+    private:
+        char const* name_;
+        tags tags_;
+        std::chrono::steady_clock::time_point start_;
+    };
+
+private:
+    static std::atomic<bool> enabled_;
+};
+
+}
+}
+
+#endif
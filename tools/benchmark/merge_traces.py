@@ -0,0 +1,55 @@
+#!/usr/bin/env python
+from __future__ import print_function
+import argparse
+import glob
+import json
+import sys
+
+
+def main():
+	parser = argparse.ArgumentParser(
+		description='Merges the <prefix>_locality_<rank>.json traces of a run into one Chrome '
+			'trace, to be opened in chrome://tracing or ui.perfetto.dev.')
+	parser.add_argument('traces', nargs='+',
+		help='trace files, or the file prefix of the Trace element of the config')
+	parser.add_argument('-o', '--output', default='trace.json')
+	parser.add_argument('--align', action='store_true',
+		help='start every locality at 0, for localities on machines with unrelated clocks')
+	args = parser.parse_args()
+
+	files = []
+	for t in args.traces:
+		files += sorted(glob.glob(t + '_locality_*.json')) if not t.endswith('.json') else [t]
+
+	if not files:
+		print('Error: no traces found!', file=sys.stderr)
+		return 1
+
+	localities = []
+	for path in files:
+		with open(path) as f:
+			localities.append(json.load(f)['traceEvents'])
+
+	def first(events):
+		return min([e['ts'] for e in events if 'ts' in e] or [0])
+
+	# the steady clock of one machine is shared, so only its offset goes
+	start = min(first(events) for events in localities)
+
+	merged = []
+	for events in localities:
+		offset = first(events) if args.align else start
+		for e in events:
+			if 'ts' in e:
+				e['ts'] -= offset
+			merged.append(e)
+
+	with open(args.output, 'w') as f:
+		json.dump({'displayTimeUnit': 'ns', 'traceEvents': merged}, f)
+
+	print('Merged', len(files), 'localities,', len(merged), 'events into', args.output)
+	return 0
+
+
+if __name__ == '__main__':
+	sys.exit(main())
@@ -0,0 +1,348 @@
+#!/usr/bin/env python
+from __future__ import print_function
+import argparse
+import itertools
+import json
+import os
+import re
+import subprocess
+import sys
+import time
+import xml.etree.ElementTree as ET
+
+# must match nast_hpx::util::phase_timer::name
+phases = ['set_velocity', 'halo_send', 'halo_wait', 'fg', 'rhs', 'extrapolate_p', 'set_p',
+	'jacobi',
+	'chebyshev', 'direct_solve', 'residual', 'residual_reduction', 'update_velocity', 'output']
+
+counter_pattern = re.compile(
+	r'^/(nast_hpx|threads)\{locality#([0-9]+)/total\}/(phase/(\w+)/(time|count)|idle-rate),'
+	r'[0-9]+,[0-9.eE+-]+,\[s\],([0-9.eE+-]+)', re.MULTILINE)
+elapsed_pattern = re.compile(r'^iteration ([0-9]+) elapsed ([0-9.eE+-]+)s', re.MULTILINE)
+
+
+def parse_list(s, conv=int):
+	return [conv(x) for x in s.split(',') if x]
+
+
+def parse_size(s):
+	dims = [int(x) for x in s.lower().split('x')]
+	if len(dims) != 3:
+		raise argparse.ArgumentTypeError('size "' + s + '" is not of the form IxJxK')
+	return tuple(dims)
+
+
+def parse_setting(s):
+	if '=' not in s:
+		raise argparse.ArgumentTypeError('setting "' + s + '" is not of the form name=v1,v2')
+	name, values = s.split('=', 1)
+	return name, values.split(',')
+
+
+def cube_root(n):
+	r = int(round(n ** (1. / 3)))
+	return r if r ** 3 == n else None
+
+
+def domain_for(size, mode, localities, threads):
+	"""interior cells and length factor of the run, None if the partition does not work out"""
+	n = cube_root(localities)
+	if n is None:
+		return None
+
+	if mode == 'strong':
+		if any((d + 2) % n != 0 for d in size):
+			return None
+		return size, (1, 1, 1)
+
+	# weak: constant cells per worker, x grows with the threads as well
+	factors = (n * threads, n, n)
+	return tuple((d + 2) * f - 2 for d, f in zip(size, factors)), factors
+
+
+def write_config(template, path, size, factors, settings, keep_output):
+	tree = ET.parse(template)
+	root = tree.getroot()
+
+	domain = root.find('Geometry/Domain')
+	if domain is None:
+		print('Error:', template, 'needs a Geometry with a Domain!', file=sys.stderr)
+		sys.exit(1)
+
+	# the cell size stays the same when the domain grows
+	for attr, length, cells, f in zip(['iMax', 'jMax', 'kMax'],
+			['xLength', 'yLength', 'zLength'], size, factors):
+		domain.set(attr, str(cells))
+		if domain.get(length) is not None:
+			domain.set(length, repr(float(domain.get(length)) * f))
+
+	if not keep_output:
+		for name in ['OutputViews', 'Monitors', 'Telemetry']:
+			for node in root.findall(name):
+				root.remove(node)
+		settings = [('vtk', '0')] + list(settings)
+
+	for name, value in settings:
+		node = root.find(name)
+		if node is None:
+			node = ET.SubElement(root, name)
+		node.attrib.clear()
+		node.set('value', value)
+
+	tree.write(path, xml_declaration=True, encoding='UTF-8')
+
+
+def command(args, cfg_path, localities, threads):
+	counters = ['/nast_hpx{locality#*/total}/phase/' + p + '/' + kind
+		for p in phases for kind in ['time', 'count']]
+	counters.append('/threads{locality#*/total}/idle-rate')
+
+	program_args = ['--cfg=' + cfg_path, '--timesteps=' + str(args.timesteps),
+		'--iterations=' + str(args.iterations)]
+	program_args += ['--hpx:print-counter=' + c for c in counters]
+
+	if localities == 1:
+		return [args.nast_hpx, '--hpx:threads=' + str(threads)] + program_args
+
+	return [args.hpxrun, '-l', str(localities), '-t', str(threads), '-p', args.parcelport,
+		args.nast_hpx, '--'] + program_args
+
+
+def parse_output(output, iterations):
+	result = {'phases': {}, 'idle_rate': None}
+
+	elapsed = [float(m.group(2)) for m in elapsed_pattern.finditer(output)]
+	if not elapsed:
+		return None
+
+	# nast_hpx leaves out the first run as warm up if there is more than one
+	timed = elapsed[1:] if len(elapsed) > 1 else elapsed
+	result['time'] = sum(timed) / len(timed)
+	result['time_min'] = min(timed)
+
+	idle_rates = []
+	for m in counter_pattern.finditer(output):
+		value = float(m.group(6))
+		if m.group(1) == 'threads':
+			idle_rates.append(value / 100.)
+			continue
+
+		phase = result['phases'].setdefault(m.group(4), {'time': 0., 'count': 0})
+		if m.group(5) == 'time':
+			# summed over all threads and localities, ns per run
+			phase['time'] += value * 1e-9 / iterations
+		else:
+			phase['count'] += int(value) // iterations
+
+	if idle_rates:
+		result['idle_rate'] = sum(idle_rates) / len(idle_rates)
+
+	total = sum(p['time'] for p in result['phases'].values())
+	for p in result['phases'].values():
+		p['fraction'] = p['time'] / total if total > 0 else 0.
+
+	return result
+
+
+def git_version():
+	try:
+		return subprocess.check_output(['git', 'describe', '--always', '--dirty'],
+			cwd=os.path.dirname(os.path.abspath(__file__)),
+			stderr=open(os.devnull, 'w')).decode().strip()
+	except (OSError, subprocess.CalledProcessError):
+		return None
+
+
+def add_efficiency(records):
+	"""speedup and efficiency against the run with the fewest workers of the same case"""
+	groups = {}
+	for r in records:
+		groups.setdefault((r['mode'], r['size'], json.dumps(r['settings'], sort_keys=True)), []).append(r)
+
+	for group in groups.values():
+		base = min(group, key=lambda r: (r['workers'], r['time']))
+		for r in group:
+			if r['mode'] == 'strong':
+				r['speedup'] = base['time'] / r['time']
+				r['efficiency'] = r['speedup'] * base['workers'] / r['workers']
+			else:
+				r['speedup'] = base['time'] / r['time'] * r['workers'] / base['workers']
+				r['efficiency'] = base['time'] / r['time']
+
+
+def case_key(r):
+	return (r['mode'], r['size'], r['localities'], r['threads'],
+		json.dumps(r['settings'], sort_keys=True))
+
+
+def compare(records, baseline_path, tolerance):
+	baseline = {}
+	with open(baseline_path) as f:
+		for line in f:
+			if line.strip():
+				r = json.loads(line)
+				r['size'] = tuple(r['size'])
+				baseline[case_key(r)] = r
+
+	regressions = 0
+	print()
+	print('%-8s %-14s %4s %4s %10s %10s %8s' % ('mode', 'size', 'loc', 'thr', 'base (s)', 'now (s)', 'change'))
+	for r in records:
+		b = baseline.get(case_key(r))
+		if b is None:
+			continue
+
+		change = r['time'] / b['time'] - 1.
+		flag = ''
+		if change > tolerance:
+			flag = ' REGRESSION'
+			regressions += 1
+
+		print('%-8s %-14s %4d %4d %10.4f %10.4f %+7.1f%%%s' % (r['mode'], 'x'.join(map(str, r['size'])),
+			r['localities'], r['threads'], b['time'], r['time'], 100. * change, flag))
+
+	return regressions
+
+
+def main():
+	parser = argparse.ArgumentParser(
+		description='Runs nast_hpx over a matrix of localities, threads, grid sizes and '
+			'solver settings and writes one JSON record per run.')
+	parser.add_argument('--nast-hpx', default='./nast_hpx', help='path to the nast_hpx binary')
+	parser.add_argument('--hpxrun', default='hpxrun.py',
+		help='launcher for several localities on this machine')
+	parser.add_argument('--parcelport', default='tcp')
+	parser.add_argument('--cfg', required=True,
+		help='config xml with a Geometry, its Domain is replaced by the sizes')
+	parser.add_argument('--mode', choices=['strong', 'weak'], default='strong')
+	parser.add_argument('--localities', type=parse_list, default=[1],
+		help='comma separated, cubes of integers (1,8,27,...)')
+	parser.add_argument('--threads', type=parse_list, default=[1, 2, 4])
+	parser.add_argument('--sizes', type=parse_size, nargs='+', default=[(62, 62, 62)],
+		help='interior cells IxJxK, per locality and thread for weak scaling')
+	parser.add_argument('--set', type=parse_setting, action='append', default=[],
+		dest='settings', metavar='NAME=V1,V2',
+		help='config value to vary, e.g. --set omega=1.5,1.7 --set iterMax=50')
+	parser.add_argument('--timesteps', type=int, default=20)
+	parser.add_argument('--iterations', type=int, default=3,
+		help='runs per configuration, the first one is a warm up')
+	parser.add_argument('--timeout', type=float, default=3600.)
+	parser.add_argument('--keep-output', action='store_true',
+		help='keep the output of the config instead of disabling it')
+	parser.add_argument('--workdir', default='scaling_runs', help='configs and logs of the runs')
+	parser.add_argument('--output', default='scaling.jsonl')
+	parser.add_argument('--label', default=None, help='version label, defaults to git describe')
+	parser.add_argument('--baseline', default=None,
+		help='results of an earlier version to compare the times against')
+	parser.add_argument('--tolerance', type=float, default=0.05,
+		help='slow down counted as regression when comparing')
+	parser.add_argument('--dry-run', action='store_true', help='only print the commands')
+	args = parser.parse_args()
+
+	# the runs start in the workdir
+	if os.sep in args.nast_hpx:
+		args.nast_hpx = os.path.abspath(args.nast_hpx)
+
+	if not os.path.isdir(args.workdir) and not args.dry_run:
+		os.makedirs(args.workdir)
+
+	version = args.label or git_version()
+	names = [name for name, _ in args.settings]
+	setting_values = list(itertools.product(*[values for _, values in args.settings]))
+
+	records = []
+	for size, values, localities, threads in itertools.product(
+			args.sizes, setting_values, args.localities, args.threads):
+		domain = domain_for(size, args.mode, localities, threads)
+		if domain is None:
+			print('Skipping', 'x'.join(map(str, size)), 'on', localities,
+				'localities: needs a cube number of localities dividing the cells + 2', file=sys.stderr)
+			continue
+
+		cells, factors = domain
+		settings = list(zip(names, values))
+		tag = '_'.join(['x'.join(map(str, size)), 'l' + str(localities), 't' + str(threads)]
+			+ [n + '-' + v for n, v in settings])
+
+		cfg_path = os.path.join(args.workdir, tag + '.xml')
+		cmd = command(args, os.path.abspath(cfg_path), localities, threads)
+
+		print(' '.join(cmd))
+		if args.dry_run:
+			continue
+
+		write_config(args.cfg, cfg_path, cells, factors, settings, args.keep_output)
+
+		start = time.time()
+		try:
+			proc = subprocess.Popen(cmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+				cwd=args.workdir)
+		except OSError as e:
+			print('Error: could not start', cmd[0] + ':', e, file=sys.stderr)
+			continue
+
+		try:
+			output = proc.communicate(timeout=args.timeout)[0] if sys.version_info[0] > 2 \
+				else proc.communicate()[0]
+		except subprocess.TimeoutExpired:
+			proc.kill()
+			output = proc.communicate()[0]
+		output = output.decode(errors='replace') if sys.version_info[0] > 2 else output
+
+		with open(os.path.join(args.workdir, tag + '.log'), 'w') as log:
+			log.write(output)
+
+		result = parse_output(output, args.iterations)
+		if proc.returncode != 0 or result is None:
+			print('Error: run failed, see', os.path.join(args.workdir, tag + '.log'), file=sys.stderr)
+			continue
+
+		record = {
+			'version': version,
+			'mode': args.mode,
+			'size': size,
+			'cells': list(cells),
+			'localities': localities,
+			'threads': threads,
+			'workers': localities * threads,
+			'settings': dict(settings),
+			'timesteps': args.timesteps,
+			'wall': time.time() - start,
+		}
+		record.update(result)
+		record['cells_per_second'] = \
+			args.timesteps * (cells[0] + 2) * (cells[1] + 2) * (cells[2] + 2) / record['time']
+		records.append(record)
+
+		print('  %.4f s, %.3g cells/s' % (record['time'], record['cells_per_second']))
+
+	if args.dry_run:
+		return 0
+
+	add_efficiency(records)
+
+	with open(args.output, 'w') as f:
+		for r in records:
+			f.write(json.dumps(r, sort_keys=True) + '\n')
+
+	print()
+	print('%-8s %-14s %4s %4s %10s %8s %8s %8s %10s %10s  %s' % ('mode', 'size', 'loc', 'thr',
+		'time (s)', 'speedup', 'eff', 'idle', 'jacobi', 'halo_wait', 'settings'))
+	for r in records:
+		def fraction(p):
+			return r['phases'][p]['fraction'] if p in r['phases'] else float('nan')
+
+		print('%-8s %-14s %4d %4d %10.4f %8.2f %8.2f %8s %9.1f%% %9.1f%%  %s' % (r['mode'],
+			'x'.join(map(str, r['size'])), r['localities'], r['threads'], r['time'], r['speedup'],
+			r['efficiency'], '-' if r['idle_rate'] is None else '%.1f%%' % r['idle_rate'],
+			100. * fraction('jacobi'), 100. * fraction('halo_wait'),
+			' '.join(k + '=' + v for k, v in sorted(r['settings'].items()))))
+
+	if args.baseline is not None:
+		return 1 if compare(records, args.baseline, args.tolerance) > 0 else 0
+
+	return 0
+
+
+if __name__ == '__main__':
+	sys.exit(main())